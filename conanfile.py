@@ -15,6 +15,7 @@ class Project(ConanFile):
     requires = [
         "nlohmann_json/3.12.0",
         "clipper2/1.5.3",
+        "zlib/1.3.1",
         #"opencascade/7.9.1"
     ]
 
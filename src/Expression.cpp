@@ -0,0 +1,316 @@
+#include "Expression.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+
+namespace {
+
+enum Op : uint8_t {
+    CONSTANT, // push constant
+    VARIABLE, // push variable
+    NEG,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    POW,
+    MIN,
+    MAX,
+    ABS,
+    SQRT,
+    FLOOR,
+    CEIL,
+    ROUND,
+};
+
+// functions with number of arguments
+struct Function {
+    std::string_view name;
+    Op op;
+    int argumentCount;
+};
+
+constexpr Function functions[] = {
+    {"min", MIN, 2},
+    {"max", MAX, 2},
+    {"abs", ABS, 1},
+    {"sqrt", SQRT, 1},
+    {"floor", FLOOR, 1},
+    {"ceil", CEIL, 1},
+    {"round", ROUND, 1},
+};
+
+constexpr int MAX_STACK_SIZE = 64;
+
+// maximum nesting of parentheses, unary operators and function arguments, bounds the recursion of the parser
+constexpr int MAX_NESTING = 64;
+
+bool isIdentifierStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool isIdentifier(char c) {
+    return isIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+} // namespace
+
+
+// recursive descent parser that emits bytecode
+class ExpressionParser {
+public:
+    ExpressionParser(Expression &e, std::string_view source) : e(e), s(source) {}
+
+    bool parse(std::string &error) {
+        expression();
+        skipSpace();
+        if (this->error.empty() && this->i < this->s.size())
+            fail("unexpected '" + std::string(1, this->s[this->i]) + "'");
+        error = this->error;
+        return this->error.empty();
+    }
+
+protected:
+    // expression = term {('+' | '-') term}
+    void expression() {
+        term();
+        while (true) {
+            if (accept('+')) {
+                term();
+                emit(ADD, 0, -1);
+            } else if (accept('-')) {
+                term();
+                emit(SUB, 0, -1);
+            } else {
+                break;
+            }
+        }
+    }
+
+    // term = unary {('*' | '/') unary}
+    void term() {
+        unary();
+        while (true) {
+            if (accept('*')) {
+                unary();
+                emit(MUL, 0, -1);
+            } else if (accept('/')) {
+                unary();
+                emit(DIV, 0, -1);
+            } else {
+                break;
+            }
+        }
+    }
+
+    // unary = '-' unary | '+' unary | power
+    void unary() {
+        // all recursion of the parser goes through unary
+        if (this->nesting >= MAX_NESTING) {
+            fail("expression too complex");
+            return;
+        }
+        ++this->nesting;
+        unaryBody();
+        --this->nesting;
+    }
+
+    void unaryBody() {
+        if (accept('-')) {
+            unary();
+            emit(NEG, 0, 0);
+        } else if (accept('+')) {
+            unary();
+        } else {
+            power();
+        }
+    }
+
+    // power = primary ['^' unary]
+    void power() {
+        primary();
+        if (accept('^')) {
+            unary();
+            emit(POW, 0, -1);
+        }
+    }
+
+    // primary = number | variable | function '(' expression {',' expression} ')' | '(' expression ')'
+    void primary() {
+        if (!this->error.empty())
+            return;
+        skipSpace();
+        if (this->i >= this->s.size()) {
+            fail("unexpected end");
+            return;
+        }
+        char c = this->s[this->i];
+        if (accept('(')) {
+            expression();
+            expect(')');
+        } else if ((c >= '0' && c <= '9') || c == '.') {
+            double value;
+            auto begin = this->s.data() + this->i;
+            auto result = std::from_chars(begin, this->s.data() + this->s.size(), value);
+            if (result.ec != std::errc()) {
+                fail("invalid number");
+                return;
+            }
+            this->i += result.ptr - begin;
+            emit(CONSTANT, add(this->e.constants, value), 1);
+        } else if (isIdentifierStart(c)) {
+            size_t start = this->i;
+            while (this->i < this->s.size() && isIdentifier(this->s[this->i]))
+                ++this->i;
+            std::string name(this->s.substr(start, this->i - start));
+            if (accept('(')) {
+                // function call
+                auto f = std::find_if(std::begin(functions), std::end(functions),
+                    [&name](const Function &function) {return function.name == name;});
+                if (f == std::end(functions)) {
+                    fail("unknown function " + name);
+                    return;
+                }
+                for (int j = 0; j < f->argumentCount; ++j) {
+                    if (j > 0)
+                        expect(',');
+                    expression();
+                }
+                expect(')');
+                emit(f->op, 0, 1 - f->argumentCount);
+            } else {
+                emit(VARIABLE, add(this->e.variables, name), 1);
+            }
+        } else {
+            fail("unexpected '" + std::string(1, c) + "'");
+        }
+    }
+
+    template <typename T>
+    static uint32_t add(std::vector<T> &list, const T &value) {
+        auto it = std::find(list.begin(), list.end(), value);
+        if (it != list.end())
+            return it - list.begin();
+        list.push_back(value);
+        return list.size() - 1;
+    }
+
+    void emit(Op op, uint32_t operand, int stackEffect) {
+        this->e.code.push_back(op | (operand << 8));
+        this->depth += stackEffect;
+        this->e.stackSize = std::max(this->e.stackSize, this->depth);
+        if (this->e.stackSize > MAX_STACK_SIZE)
+            fail("expression too complex");
+    }
+
+    void skipSpace() {
+        while (this->i < this->s.size() && (this->s[this->i] == ' ' || this->s[this->i] == '\t'))
+            ++this->i;
+    }
+
+    bool accept(char c) {
+        skipSpace();
+        if (this->error.empty() && this->i < this->s.size() && this->s[this->i] == c) {
+            ++this->i;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!accept(c))
+            fail("expected '" + std::string(1, c) + "'");
+    }
+
+    void fail(const std::string &message) {
+        if (this->error.empty())
+            this->error = message;
+    }
+
+    Expression &e;
+    std::string_view s;
+    size_t i = 0;
+    int depth = 0;
+    int nesting = 0;
+    std::string error;
+};
+
+
+bool Expression::compile(std::string_view source, std::string &error) {
+    this->code.clear();
+    this->constants.clear();
+    this->variables.clear();
+    this->stackSize = 0;
+    ExpressionParser parser(*this, source);
+    if (!parser.parse(error)) {
+        this->code.clear();
+        return false;
+    }
+    return true;
+}
+
+double Expression::evaluate(const double *values) const {
+    if (this->code.empty())
+        return 0;
+    double stack[MAX_STACK_SIZE];
+    int sp = 0;
+    for (uint32_t instruction : this->code) {
+        uint32_t operand = instruction >> 8;
+        switch (Op(instruction & 0xff)) {
+        case CONSTANT:
+            stack[sp++] = this->constants[operand];
+            break;
+        case VARIABLE:
+            stack[sp++] = values[operand];
+            break;
+        case NEG:
+            stack[sp - 1] = -stack[sp - 1];
+            break;
+        case ADD:
+            --sp;
+            stack[sp - 1] += stack[sp];
+            break;
+        case SUB:
+            --sp;
+            stack[sp - 1] -= stack[sp];
+            break;
+        case MUL:
+            --sp;
+            stack[sp - 1] *= stack[sp];
+            break;
+        case DIV:
+            --sp;
+            stack[sp - 1] /= stack[sp];
+            break;
+        case POW:
+            --sp;
+            stack[sp - 1] = std::pow(stack[sp - 1], stack[sp]);
+            break;
+        case MIN:
+            --sp;
+            stack[sp - 1] = std::min(stack[sp - 1], stack[sp]);
+            break;
+        case MAX:
+            --sp;
+            stack[sp - 1] = std::max(stack[sp - 1], stack[sp]);
+            break;
+        case ABS:
+            stack[sp - 1] = std::abs(stack[sp - 1]);
+            break;
+        case SQRT:
+            stack[sp - 1] = std::sqrt(stack[sp - 1]);
+            break;
+        case FLOOR:
+            stack[sp - 1] = std::floor(stack[sp - 1]);
+            break;
+        case CEIL:
+            stack[sp - 1] = std::ceil(stack[sp - 1]);
+            break;
+        case ROUND:
+            stack[sp - 1] = std::round(stack[sp - 1]);
+            break;
+        }
+    }
+    return stack[0];
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// arithmetic expression compiled to a compact bytecode for a stack machine. Supports numbers, variables, + - * / ^,
+// parentheses and the functions min, max, abs, sqrt, floor, ceil and round
+class Expression {
+public:
+    // compile an expression, returns false and sets error on a syntax error
+    bool compile(std::string_view source, std::string &error);
+
+    // names of the variables, the values have to be passed to evaluate() in this order
+    const std::vector<std::string> &getVariables() const {return this->variables;}
+
+    // evaluate the expression with given values of the variables
+    double evaluate(const double *values) const;
+
+protected:
+    // instruction: operation in the lower 8 bits, operand (index of constant or variable) in the upper 24 bits
+    std::vector<uint32_t> code;
+    std::vector<double> constants;
+    std::vector<std::string> variables;
+
+    // maximum stack depth during evaluation
+    int stackSize = 0;
+
+    friend class ExpressionParser;
+};
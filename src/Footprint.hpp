@@ -2,6 +2,9 @@
 
 //#include "clipper2.hpp"
 #include "double3.hpp"
+#include "Expression.hpp"
+#include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -65,6 +68,50 @@ struct Footprint {
         TOP_RIGHT,
     };
 
+    // density level of land patterns (IPC-7351)
+    enum class Density {
+        // most material (level A)
+        MOST,
+
+        // nominal material (level B)
+        NOMINAL,
+
+        // least material (level C)
+        LEAST,
+    };
+
+    // component dimensions for calculating the land pattern of a pad array (IPC-7351). Dimensions are given as
+    // minimum and maximum
+    struct Land {
+        enum class Lead {
+            // no land pattern, size and distance are given explicitly
+            NONE,
+
+            // gull wing leads (SOIC, QFP)
+            GULLWING,
+
+            // j-leads (SOJ, PLCC)
+            JLEAD,
+
+            // rectangular or square end chip components (resistors, capacitors)
+            CHIP,
+
+            // flat no-lead packages (QFN, SON)
+            FLAT,
+        };
+
+        Lead lead = Lead::NONE;
+
+        // lead span from toe to toe, or body length of chip components
+        double2 span;
+
+        // length of the lead or terminal that touches the land
+        double2 terminal;
+
+        // width of the lead or terminal
+        double2 width;
+    };
+
     // pad or pad array
     struct Pad {
         enum class Type {
@@ -160,6 +207,9 @@ struct Footprint {
         // pad names (override numbers)
         std::vector<std::string> names;
 
+        // component dimensions, size and distance get calculated if a lead type is given
+        Land land;
+
         // check if pin exists (pin with empty name does not exist)
         bool exists(int index) const {
             return index >= this->names.size() || !this->names[index].empty();
@@ -173,6 +223,18 @@ struct Footprint {
                 return this->names[index];
             }
         }
+
+        // number of pad rows of the array
+        int getRowCount() const {
+            switch (this->type) {
+            case Type::DUAL:
+                return 2;
+            case Type::QUAD:
+                return 4;
+            default:
+                return 1;
+            }
+        }
     };
 
     // line or polyline
@@ -190,6 +252,34 @@ struct Footprint {
         double radius = 0.5;
     };
 
+    // parameter sweep, the footprint is a family of variants if at least one parameter has values. The name of the
+    // footprint is a pattern that may contain {count}, {rows}, {pins} and {pitch}
+    struct Variants {
+        // index of pad array the parameters apply to
+        int pad = 0;
+
+        // number of pads per row
+        std::vector<int> counts;
+
+        // number of rows (1: single, 2: dual)
+        std::vector<int> rows;
+
+        // pitch between pads
+        std::vector<double> pitches;
+
+        bool empty() const {
+            return this->counts.empty() && this->rows.empty() && this->pitches.empty();
+        }
+
+        // number of variants
+        int size() const {
+            if (empty())
+                return 0;
+            return std::max(int(this->counts.size()), 1) * std::max(int(this->rows.size()), 1)
+                * std::max(int(this->pitches.size()), 1);
+        }
+    };
+
 
     // true if this is a template, i.e. no footprint gets generated
     bool template_ = false;
@@ -197,6 +287,9 @@ struct Footprint {
     // description of footprint
     std::string description;
 
+    // name of the footprint this footprint inherits from, empty if none
+    std::string inherit;
+
     // through-hole or smd
     Type type = Type::DETECT;
 
@@ -225,6 +318,9 @@ struct Footprint {
 
     Orientation orientation = Orientation::BOTTOM_LEFT;
 
+    // density level of land patterns
+    Density density = Density::NOMINAL;
+
     // list of pads (pad arrays)
     std::vector<Pad> pads;
 
@@ -233,6 +329,28 @@ struct Footprint {
     std::vector<Line> lines;
     std::vector<Circle> circles;
 
+    // variants of a footprint family
+    Variants variants;
+
+    // field that is given as expression, evaluated when the footprint is read and again for each variant
+    struct Binding {
+        // index of pad or -1 for a field of the footprint
+        int pad;
+
+        // key of the field, e.g. "distance" or "body.size"
+        std::string key;
+
+        // component of a vector field (0: x, 1: y, 2: z) or -1 for all components
+        int component;
+
+        std::string source;
+        Expression expression;
+    };
+
+    // named parameters that can be used in expressions, inherited together with the bindings
+    std::map<std::string, double> parameters;
+    std::vector<Binding> bindings;
+
 
     // get type of footrpint
     Type getType() const {
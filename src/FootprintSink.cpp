@@ -0,0 +1,116 @@
+#include "FootprintSink.hpp"
+#include "MemoryStats.hpp"
+
+
+const std::string &PadBlock::getFormatted(int format, const std::function<std::string ()> &formatPads) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->formatted.find(format);
+    if (it == this->formatted.end())
+        it = this->formatted.emplace(format, formatPads()).first;
+    return it->second;
+}
+
+
+FootprintSink::~FootprintSink() {
+}
+
+void FootprintSink::padBlock(const PadBlock &block) {
+    for (auto &p : block.pads)
+        pad(p.name, p.position, p.size, p.offset, p.shape, p.drillSize, block.pad);
+}
+
+void FootprintSink::rectangle(double2 center, double2 size, double width, std::string_view layer) {
+    double x1 = center.x - size.x * 0.5;
+    double y1 = center.y - size.y * 0.5;
+    double x2 = center.x + size.x * 0.5;
+    double y2 = center.y + size.y * 0.5;
+    line({x1, y1}, {x2, y1}, width, layer);
+    line({x2, y1}, {x2, y2}, width, layer);
+    line({x2, y2}, {x1, y2}, width, layer);
+    line({x1, y2}, {x1, y1}, width, layer);
+}
+
+void FootprintSink::polyline(const std::vector<double2> &points, bool closed, double width, std::string_view layer) {
+    int count = points.size();
+    int segmentCount = closed ? count : count - 1;
+    for (int i = 0; i < segmentCount; ++i)
+        line(points[i], points[(i + 1) % count], width, layer);
+}
+
+void SinkList::begin(const std::string &name, const Footprint &footprint, bool haveBody) {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->begin(name, footprint, haveBody);
+}
+
+void SinkList::body(double3 center, double3 size) {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->body(center, size);
+}
+
+void SinkList::pad(std::string_view name, double2 position, double2 size, double2 offset, double shape,
+    double2 drillSize, const Footprint::Pad &pad)
+{
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->pad(name, position, size, offset, shape, drillSize, pad);
+}
+
+void SinkList::padBlock(const PadBlock &block) {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->padBlock(block);
+}
+
+void SinkList::line(double2 p1, double2 p2, double width, std::string_view layer) {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->line(p1, p2, width, layer);
+}
+
+void SinkList::rectangle(double2 center, double2 size, double width, std::string_view layer) {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->rectangle(center, size, width, layer);
+}
+
+void SinkList::polyline(const std::vector<double2> &points, bool closed, double width, std::string_view layer) {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->polyline(points, closed, width, layer);
+}
+
+void SinkList::line(double2 position, const Footprint::Line &line) {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->line(position, line);
+}
+
+void SinkList::circle(double2 position, const Footprint::Circle &circle) {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->circle(position, circle);
+}
+
+void SinkList::end() {
+    MemoryScope scope(MemoryStage::FORMAT);
+    for (auto &sink : this->sinks)
+        sink->end();
+}
+
+std::unique_ptr<SinkList> createSinks(const SinkOptions &options, const fs::path &dir, Output &output) {
+    auto sinks = std::make_unique<SinkList>();
+    int formats = options.formats;
+    if (formats & KICAD)
+        sinks->add(createKicadSink(dir, output, options));
+    if (formats & VRML)
+        sinks->add(createVrmlSink(dir, output, options));
+    if (formats & STEP)
+        sinks->add(createStepSink(dir, output));
+    if (formats & SVG)
+        sinks->add(createSvgSink(dir, output));
+    if (formats & XML)
+        sinks->add(createXmlSink(dir, output));
+    return sinks;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Footprint.hpp"
+#include "Output.hpp"
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// pads of a pad array as generated by one layout pass. Footprints that have the same pad array at the same position,
+// e.g. footprints that inherit from the same template, share one block
+struct PadBlock {
+    struct Entry {
+        std::string name;
+        double2 position;
+        double2 size;
+        double2 offset;
+        double shape;
+        double2 drillSize;
+    };
+
+    // parameters of the pad array
+    Footprint::Pad pad;
+
+    // generated pads
+    std::vector<Entry> pads;
+
+    // get the formatted pads for an output format, the format function is called only once per block and format
+    const std::string &getFormatted(int format, const std::function<std::string ()> &formatPads) const;
+
+protected:
+    mutable std::mutex mutex;
+    mutable std::map<int, std::string> formatted;
+};
+
+// receives the geometry of a footprint from a single layout pass (see layoutFootprint()). Each output format is a
+// sink, a sink ignores the parts of the geometry it does not need
+class FootprintSink {
+public:
+    virtual ~FootprintSink();
+
+    // start of a footprint, haveBody is true if the footprint has a body
+    virtual void begin(const std::string &name, const Footprint &footprint, bool haveBody) {}
+
+    // body as box in 3D coordinates (y up), center is at the bottom of the box
+    virtual void body(double3 center, double3 size) {}
+
+    // pad at absolute position, offset is the offset of the pad relative to the drill
+    virtual void pad(std::string_view name, double2 position, double2 size, double2 offset, double shape,
+        double2 drillSize, const Footprint::Pad &pad) {}
+
+    // pads of a pad array, calls pad() for each pad unless a sink reuses its formatted output of the block
+    virtual void padBlock(const PadBlock &block);
+
+    // generated line segment, e.g. silkscreen, fabrication layer or courtyard
+    virtual void line(double2 p1, double2 p2, double width, std::string_view layer) {}
+
+    // generated rectangle outline, calls line() for each side unless a sink has a rectangle primitive
+    virtual void rectangle(double2 center, double2 size, double width, std::string_view layer);
+
+    // generated polyline, the last point connects to the first if closed. Calls line() for each segment unless a sink
+    // has a polygon primitive
+    virtual void polyline(const std::vector<double2> &points, bool closed, double width, std::string_view layer);
+
+    // line of the footprint, the points are relative to position
+    virtual void line(double2 position, const Footprint::Line &line) {}
+
+    // circle of the footprint, the center is relative to position
+    virtual void circle(double2 position, const Footprint::Circle &circle) {}
+
+    // end of footprint, the sink writes its files to the output
+    virtual void end() {}
+};
+
+// forwards the geometry to a list of sinks so that one layout pass feeds all output formats
+class SinkList : public FootprintSink {
+public:
+    void add(std::unique_ptr<FootprintSink> sink) {this->sinks.push_back(std::move(sink));}
+    bool empty() const {return this->sinks.empty();}
+
+    void begin(const std::string &name, const Footprint &footprint, bool haveBody) override;
+    void body(double3 center, double3 size) override;
+    void pad(std::string_view name, double2 position, double2 size, double2 offset, double shape,
+        double2 drillSize, const Footprint::Pad &pad) override;
+    void padBlock(const PadBlock &block) override;
+    void line(double2 p1, double2 p2, double width, std::string_view layer) override;
+    void rectangle(double2 center, double2 size, double width, std::string_view layer) override;
+    void polyline(const std::vector<double2> &points, bool closed, double width, std::string_view layer) override;
+    void line(double2 position, const Footprint::Line &line) override;
+    void circle(double2 position, const Footprint::Circle &circle) override;
+    void end() override;
+
+protected:
+    std::vector<std::unique_ptr<FootprintSink>> sinks;
+};
+
+
+// output formats
+enum Format {
+    KICAD = 1, // .kicad_mod
+    VRML = 2, // .wrl or .wrz
+    STEP = 4, // .step
+    SVG = 8, // .svg preview
+    XML = 16, // .xml land pattern in IPC-7351 style
+};
+
+// options of the output formats
+struct SinkOptions {
+    // combination of Format flags
+    int formats = KICAD | VRML | STEP;
+
+    // load the step plugin (OpenCASCADE) for step export and for tessellating vrml models, without it the vrml model
+    // is a built-in box
+    bool usePlugin = true;
+
+    // maximum deviation of tessellated 3D models from the shape in mm
+    double deflection = 0.01;
+
+    // write vrml compressed with gzip (.wrz instead of .wrl)
+    bool compressVrml = false;
+
+    // file extension of the vrml model
+    const char *getVrmlExtension() const {return this->compressVrml ? ".wrz" : ".wrl";}
+};
+
+// sinks that write files to the given directory of the output
+std::unique_ptr<FootprintSink> createKicadSink(const fs::path &dir, Output &output, const SinkOptions &options);
+std::unique_ptr<FootprintSink> createVrmlSink(const fs::path &dir, Output &output, const SinkOptions &options);
+std::unique_ptr<FootprintSink> createStepSink(const fs::path &dir, Output &output);
+std::unique_ptr<FootprintSink> createSvgSink(const fs::path &dir, Output &output);
+std::unique_ptr<FootprintSink> createXmlSink(const fs::path &dir, Output &output);
+
+// create a list of sinks for the enabled formats
+std::unique_ptr<SinkList> createSinks(const SinkOptions &options, const fs::path &dir, Output &output);
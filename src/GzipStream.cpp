@@ -0,0 +1,59 @@
+#include "GzipStream.hpp"
+#include <algorithm>
+#include <zlib.h>
+
+
+GzipStream::GzipStream(int level) : std::ostream(nullptr), buffer(level) {
+    rdbuf(&this->buffer);
+}
+
+GzipStream::~GzipStream() {
+}
+
+std::string GzipStream::finish() {
+    if (!this->buffer.deflate(Z_FINISH))
+        setstate(std::ios::badbit);
+    return std::move(this->buffer.output);
+}
+
+GzipStream::Buffer::Buffer(int level) : stream(std::make_unique<z_stream>()) {
+    // window bits + 16 writes a gzip header instead of a zlib header
+    deflateInit2(this->stream.get(), level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+    setp(this->input, this->input + sizeof(this->input));
+}
+
+GzipStream::Buffer::~Buffer() {
+    deflateEnd(this->stream.get());
+}
+
+bool GzipStream::Buffer::deflate(int flush) {
+    auto &stream = *this->stream;
+    stream.next_in = reinterpret_cast<Bytef *>(pbase());
+    stream.avail_in = pptr() - pbase();
+    int result;
+    do {
+        // grow output
+        size_t size = this->output.size();
+        size_t available = std::max(size_t(stream.avail_in) / 2, size_t(4096));
+        this->output.resize(size + available);
+        stream.next_out = reinterpret_cast<Bytef *>(this->output.data() + size);
+        stream.avail_out = available;
+
+        result = ::deflate(&stream, flush);
+        this->output.resize(size + available - stream.avail_out);
+        if (result == Z_STREAM_ERROR)
+            return false;
+    } while (stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    setp(this->input, this->input + sizeof(this->input));
+    return true;
+}
+
+GzipStream::Buffer::int_type GzipStream::Buffer::overflow(int_type c) {
+    if (!deflate(Z_NO_FLUSH))
+        return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
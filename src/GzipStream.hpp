@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+
+struct z_stream_s;
+
+// output stream that compresses with gzip while writing, e.g. for compressed vrml (.wrz)
+class GzipStream : public std::ostream {
+public:
+    explicit GzipStream(int level = 6);
+    ~GzipStream() override;
+
+    // finish compression and return the compressed data
+    std::string finish();
+
+protected:
+    // compresses the data in the put area into the output string whenever it is full
+    class Buffer : public std::streambuf {
+    public:
+        explicit Buffer(int level);
+        ~Buffer() override;
+
+        // compress the put area, flush is a zlib flush mode
+        bool deflate(int flush);
+
+        std::string output;
+
+    protected:
+        int_type overflow(int_type c) override;
+
+        std::unique_ptr<z_stream_s> stream;
+        char input[16384];
+    };
+
+    Buffer buffer;
+};
@@ -0,0 +1,292 @@
+#include "FootprintSink.hpp"
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+
+// define a pad
+static void writePad(std::ostream &s, std::string_view name, double2 position, double2 size, double2 offset,
+    double shape, double2 drillSize, const Footprint::Pad &pad)
+{
+    bool hasPad = size.positive();
+    bool hasDrill = drillSize.positive();
+
+    // pad
+    if (hasPad) {
+        s << "  (pad \"" << name << "\" ";
+        s << (hasDrill ? "thru_hole" : "smd");
+    } else {
+        // only hole
+        s << "  (pad \"\" np_thru_hole";
+        shape = CIRCLE;
+        size = drillSize;
+    }
+
+    // shape
+    if (shape <= RECTANGLE)
+        s << " rect";
+    else if (shape >= CIRCLE)
+        if (size.x == size.y)
+            s << " circle";
+        else
+            s << " oval";
+    else if (shape == ROUNDRECT)
+        s << " roundrect";
+    else
+        s << " roundrect (roundrect_rratio " << shape << ")";
+
+    // position/size
+    s << " (at " << position << ") (size " << size << ")";
+
+    // drill
+    if (hasDrill) {
+        s << " (drill ";
+        if (drillSize.x == drillSize.y)
+            s << drillSize.x;
+        else
+            s << "oval " << drillSize;
+        if (!offset.zero())
+            s << " (offset " << offset << ")";
+        s << ")";
+    }
+
+    // margins
+    if (pad.clearance > 0)
+        s << " (clearance " << pad.clearance << ")";
+    if (pad.maskMargin != 0)
+        s << " (solder_mask_margin " << pad.maskMargin << ")";
+
+    // layers
+    s << " (layers";
+    if (hasDrill) {
+        // front and back
+        s << " \"*.Cu\"";
+        if (pad.mask)
+            s << " \"*.Mask\"";
+    } else if (!pad.back) {
+        // front
+        s << " \"F.Cu\"";
+        if (pad.mask)
+            s << " \"F.Mask\"";
+        if (pad.paste)
+            s << " \"F.Paste\"";
+    } else {
+        // back
+        s << " \"B.Cu\"";
+        if (pad.mask)
+            s << " \"B.Mask\"";
+        if (pad.paste)
+            s << " \"B.Paste\"";
+    }
+    s << ")";
+    if (hasPad && hasDrill)
+        s << " (remove_unused_layers) (keep_end_layers)";
+
+    s << ')' << std::endl;
+}
+
+// write a single line
+static void writeLine(std::ostream &s, double2 p1, double2 p2, double width, std::string_view layer) {
+    s << "  (fp_line"
+        " (start " << p1 << ")"
+        " (end " << p2 << ")"
+        " (stroke (width " << width << ") (type solid))"
+        " (layer " << layer << ")"
+        ")" << std::endl;
+}
+
+// write rectangle outline
+static void writeRectangle(std::ostream &s, double2 center, double2 size, double width, std::string_view layer) {
+    s << "  (fp_rect"
+        " (start " << center - size * 0.5 << ")"
+        " (end " << center + size * 0.5 << ")"
+        " (stroke (width " << width << ") (type solid))"
+        " (fill none)"
+        " (layer " << layer << ")"
+        ")" << std::endl;
+}
+
+// write closed polygon outline
+static void writePolygon(std::ostream &s, const std::vector<double2> &points, double width, std::string_view layer) {
+    s << "  (fp_poly (pts";
+    for (auto &p : points)
+        s << " (xy " << p << ")";
+    s << ")"
+        " (stroke (width " << width << ") (type solid))"
+        " (fill none)"
+        " (layer " << layer << ")"
+        ")" << std::endl;
+}
+
+constexpr double lineEpsilon = 1e-6;
+
+static bool equal(double2 a, double2 b) {
+    return std::abs(a.x - b.x) <= lineEpsilon && std::abs(a.y - b.y) <= lineEpsilon;
+}
+
+// check if b lies on the line from a to c between a and c
+static bool collinear(double2 a, double2 b, double2 c) {
+    double2 ab = b - a;
+    double2 bc = c - b;
+    double cross = ab.x * bc.y - ab.y * bc.x;
+    double dot = ab.x * bc.x + ab.y * bc.y;
+    return cross * cross <= lineEpsilon * lineEpsilon * (ab.x * ab.x + ab.y * ab.y) * (bc.x * bc.x + bc.y * bc.y)
+        && dot > 0;
+}
+
+// write line consisting of multiple segments, collinear segments are merged and a closed line becomes a polygon
+static void writeLine(std::ostream &s, double2 position, const Footprint::Line &line) {
+    std::vector<double2> points;
+    for (auto p : line.points) {
+        p += position;
+        if (!points.empty() && equal(points.back(), p))
+            continue; // duplicate
+        if (points.size() >= 2 && collinear(points[points.size() - 2], points.back(), p))
+            points.back() = p;
+        else
+            points.push_back(p);
+    }
+
+    // closed: last point equals first point
+    int count = points.size();
+    if (count >= 4 && equal(points.back(), points.front())) {
+        points.pop_back();
+        writePolygon(s, points, line.width, "\"" + line.layer + "\"");
+        return;
+    }
+
+    for (int i = 0; i < count - 1; ++i) {
+        s << "  (fp_line"
+            " (start " << points[i] << ")"
+            " (end " << points[i + 1] << ")"
+            " (stroke (width " << line.width << ") (type solid))"
+            " (layer \"" << line.layer << "\")"
+            ")" << std::endl;
+    }
+}
+
+// write circle
+static void writeCircle(std::ostream &s, double2 position, const Footprint::Circle &circle) {
+    auto p1 = position + circle.center;
+    auto p2 = p1 - double2(circle.radius, 0);
+    s << "  (fp_circle"
+        " (center " << p1 << ")"
+        " (end " << p2 << ")"
+        " (stroke (width " << circle.width << ") (type default))"
+        " (fill " << (circle.fill ? "solid" : "none") << ")"
+        " (layer \"" << circle.layer << "\")"
+        ")" << std::endl;
+}
+
+static bool allowSoldermaskBridges(const Footprint &footprint) {
+    // return true if pads are a jumper
+    for (auto &pad : footprint.pads) {
+        if (pad.jumper)
+            return true;
+    }
+    return false;
+}
+
+// writes a KiCad footprint (.kicad_mod)
+class KicadSink : public FootprintSink {
+public:
+    KicadSink(const fs::path &dir, Output &output, const SinkOptions &options)
+        : dir(dir), output(output), modelExtension(options.getVrmlExtension()) {}
+
+    void begin(const std::string &name, const Footprint &footprint, bool haveBody) override {
+        this->name = name;
+        this->s.str({});
+        auto &s = this->s;
+
+        double2 refPosition = {0, 0};
+        double2 valuePosition = {0, 0};
+        double maskMargin = 0;
+        double pasteMargin = 0;
+
+        // header
+        s << "(module " << name << " (layer F.Cu) (tedit 5EC043C1)" << std::endl;
+
+        // description
+        s << "  (descr \"" << footprint.description << "\")" << std::endl;
+
+        // attributes
+        s << "  (attr";
+        s << (footprint.getType() == Footprint::Type::THROUGH_HOLE ? " through_hole" : " smd");
+        if (allowSoldermaskBridges(footprint))
+            s << " allow_soldermask_bridges";
+        s  << ')' << std::endl;
+
+        // 3D model
+        if (haveBody)
+            s << "  (model \"" << name << this->modelExtension << "\" (at (xyz 0 0 0)) (scale (xyz 1 1 1)) (rotate (xyz 0 0 0)))" << std::endl;
+
+        // reference
+        s << "  (fp_text reference REF** (at " << refPosition << ") (layer F.SilkS) (effects (font (size 1 1) (thickness 0.15))))" << std::endl;
+
+        // value
+        s << "  (fp_text value " << name << " (at " << valuePosition << ") (layer F.Fab) (effects (font (size 1 1) (thickness 0.15))))" << std::endl;
+
+        // margins
+        s << "  (solder_mask_margin " << maskMargin << ")" << std::endl;
+        s << "  (solder_paste_margin " << pasteMargin << ")" << std::endl;
+    }
+
+    void pad(std::string_view name, double2 position, double2 size, double2 offset, double shape,
+        double2 drillSize, const Footprint::Pad &pad) override
+    {
+        writePad(this->s, name, position, size, offset, shape, drillSize, pad);
+    }
+
+    void padBlock(const PadBlock &block) override {
+        // format the pads once and reuse them for all footprints that share the block
+        this->s << block.getFormatted(KICAD, [&block] {
+            std::ostringstream s;
+            for (auto &p : block.pads)
+                writePad(s, p.name, p.position, p.size, p.offset, p.shape, p.drillSize, block.pad);
+            return std::move(s).str();
+        });
+    }
+
+    void line(double2 p1, double2 p2, double width, std::string_view layer) override {
+        writeLine(this->s, p1, p2, width, layer);
+    }
+
+    void rectangle(double2 center, double2 size, double width, std::string_view layer) override {
+        writeRectangle(this->s, center, size, width, layer);
+    }
+
+    void polyline(const std::vector<double2> &points, bool closed, double width, std::string_view layer) override {
+        if (closed && points.size() >= 3) {
+            writePolygon(this->s, points, width, layer);
+        } else {
+            int segmentCount = int(points.size()) - (closed ? 0 : 1);
+            for (int i = 0; i < segmentCount; ++i)
+                writeLine(this->s, points[i], points[(i + 1) % points.size()], width, layer);
+        }
+    }
+
+    void line(double2 position, const Footprint::Line &line) override {
+        writeLine(this->s, position, line);
+    }
+
+    void circle(double2 position, const Footprint::Circle &circle) override {
+        writeCircle(this->s, position, circle);
+    }
+
+    void end() override {
+        // footer
+        this->s << ")" << std::endl;
+        this->output.write(this->dir / (this->name + ".kicad_mod"), std::move(this->s).str());
+    }
+
+protected:
+    fs::path dir;
+    Output &output;
+    const char *modelExtension;
+    std::string name;
+    std::ostringstream s;
+};
+
+std::unique_ptr<FootprintSink> createKicadSink(const fs::path &dir, Output &output, const SinkOptions &options) {
+    return std::make_unique<KicadSink>(dir, output, options);
+}
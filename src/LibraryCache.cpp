@@ -0,0 +1,549 @@
+#include "LibraryCache.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+
+// file format: header followed by arrays of fixed size records, all strings are stored in a string pool
+constexpr char CACHE_MAGIC[8] = {'F', 'P', 'C', 'A', 'C', 'H', 'E', 0};
+constexpr uint32_t CACHE_VERSION = 5;
+constexpr uint32_t CACHE_ENDIAN = 0x01020304;
+
+// reference into the string pool
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+// location of an array of records in the file
+struct Array {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct LibraryCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t sourceHash;
+
+    Array footprints;
+    Array pads;
+    Array lines;
+    Array points;
+    Array circles;
+    Array names; // pad names
+    Array values; // parameters of variants
+    Array parameters;
+    Array bindings;
+    Array strings;
+};
+
+struct LibraryCache::FootprintRecord {
+    StringRef name;
+    StringRef description;
+    StringRef inherit;
+    double body[6];
+    double silkscreenAdd[2];
+    double courtyardAdd[2];
+    double position[2];
+    uint32_t padBegin;
+    uint32_t padCount;
+    uint32_t lineBegin;
+    uint32_t lineCount;
+    uint32_t circleBegin;
+    uint32_t circleCount;
+    int32_t variantPad;
+    uint32_t valueBegin; // counts, rows and pitches of variants follow each other
+    uint32_t countCount;
+    uint32_t rowsCount;
+    uint32_t pitchCount;
+    uint32_t parameterBegin;
+    uint32_t parameterCount;
+    uint32_t bindingBegin;
+    uint32_t bindingCount;
+    uint8_t template_;
+    uint8_t type;
+    uint8_t silkscreen;
+    uint8_t courtyard;
+    uint8_t orientation;
+    uint8_t density;
+};
+
+namespace {
+
+enum PadFlags : uint8_t {
+    BACK = 1,
+    JUMPER = 2,
+    MASK = 4,
+    PASTE = 8,
+    VERTICAL = 16,
+    MIRROR = 32,
+    DOUBLE = 64,
+};
+
+struct PadRecord {
+    double position[2];
+    double distance[2];
+    double pitch;
+    double shift;
+    double size[2];
+    double offset[2];
+    double shape;
+    double drillSize[2];
+    double drillOffset[2];
+    double clearance;
+    double maskMargin;
+    double landSpan[2];
+    double landTerminal[2];
+    double landWidth[2];
+    int32_t count;
+    int32_t number;
+    int32_t increment;
+    uint32_t nameBegin;
+    uint32_t nameCount;
+    uint8_t type;
+    uint8_t numbering;
+    uint8_t flags;
+    uint8_t lead;
+};
+
+struct LineRecord {
+    StringRef layer;
+    double width;
+    uint32_t pointBegin;
+    uint32_t pointCount;
+};
+
+struct CircleRecord {
+    StringRef layer;
+    double width;
+    double center[2];
+    double radius;
+    uint8_t fill;
+};
+
+struct Point {
+    double x;
+    double y;
+};
+
+struct ParameterRecord {
+    StringRef name;
+    double value;
+};
+
+// expressions are stored as source and compiled again when decoded
+struct BindingRecord {
+    int32_t pad;
+    int32_t component;
+    StringRef key;
+    StringRef source;
+};
+
+// collects records and strings while writing a cache
+struct Writer {
+    std::vector<LibraryCache::FootprintRecord> footprints;
+    std::vector<PadRecord> pads;
+    std::vector<LineRecord> lines;
+    std::vector<Point> points;
+    std::vector<CircleRecord> circles;
+    std::vector<StringRef> names;
+    std::vector<double> values;
+    std::vector<ParameterRecord> parameters;
+    std::vector<BindingRecord> bindings;
+    std::string strings;
+
+    StringRef add(const std::string &s) {
+        StringRef ref = {uint32_t(this->strings.size()), uint32_t(s.size())};
+        this->strings += s;
+        return ref;
+    }
+};
+
+void set(double *d, double2 v) {
+    d[0] = v.x;
+    d[1] = v.y;
+}
+
+double2 get2(const double *d) {
+    return {d[0], d[1]};
+}
+
+// append an array of records to the file buffer, aligned to 8 bytes
+template <typename T>
+Array append(std::string &buffer, const T *data, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    buffer.resize((buffer.size() + 7) & ~size_t(7));
+    Array array = {buffer.size(), count};
+    buffer.append(reinterpret_cast<const char *>(data), count * sizeof(T));
+    return array;
+}
+
+// check if an array lies inside the file
+template <typename T>
+bool valid(const Array &array, size_t fileSize) {
+    return array.offset % alignof(T) == 0 && array.offset <= fileSize
+        && array.count <= (fileSize - array.offset) / sizeof(T);
+}
+
+template <typename T>
+const T *data(const char *file, const Array &array) {
+    return reinterpret_cast<const T *>(file + array.offset);
+}
+
+} // namespace
+
+
+uint64_t hashFile(const fs::path &path) {
+    MappedFile file(path);
+    uint64_t hash = 0xcbf29ce484222325;
+    for (char c : file.data()) {
+        hash ^= uint8_t(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+bool writeCache(const fs::path &path, uint64_t sourceHash, const std::map<std::string, Footprint> &footprints) {
+    Writer w;
+    for (auto &[name, footprint] : footprints) {
+        auto &f = w.footprints.emplace_back();
+        f.name = w.add(name);
+        f.description = w.add(footprint.description);
+        f.inherit = w.add(footprint.inherit);
+        auto &body = footprint.body;
+        double b[6] = {body.size.x, body.size.y, body.size.z, body.offset.x, body.offset.y, body.offset.z};
+        std::copy(b, b + 6, f.body);
+        set(f.silkscreenAdd, footprint.silkscreenAdd);
+        set(f.courtyardAdd, footprint.courtyardAdd);
+        set(f.position, footprint.position);
+        f.template_ = footprint.template_;
+        f.type = uint8_t(footprint.type);
+        f.silkscreen = footprint.silkscreen;
+        f.courtyard = footprint.courtyard;
+        f.orientation = uint8_t(footprint.orientation);
+        f.density = uint8_t(footprint.density);
+
+        // pads
+        f.padBegin = w.pads.size();
+        f.padCount = footprint.pads.size();
+        for (auto &pad : footprint.pads) {
+            auto &p = w.pads.emplace_back();
+            set(p.position, pad.position);
+            set(p.distance, pad.distance);
+            p.pitch = pad.pitch;
+            p.shift = pad.shift;
+            set(p.size, pad.size);
+            set(p.offset, pad.offset);
+            p.shape = pad.shape;
+            set(p.drillSize, pad.drillSize);
+            set(p.drillOffset, pad.drillOffset);
+            p.clearance = pad.clearance;
+            p.maskMargin = pad.maskMargin;
+            set(p.landSpan, pad.land.span);
+            set(p.landTerminal, pad.land.terminal);
+            set(p.landWidth, pad.land.width);
+            p.count = pad.count;
+            p.number = pad.number;
+            p.increment = pad.increment;
+            p.nameBegin = w.names.size();
+            p.nameCount = pad.names.size();
+            for (auto &n : pad.names)
+                w.names.push_back(w.add(n));
+            p.type = uint8_t(pad.type);
+            p.numbering = uint8_t(pad.numbering);
+            p.flags = (pad.back ? BACK : 0) | (pad.jumper ? JUMPER : 0) | (pad.mask ? MASK : 0)
+                | (pad.paste ? PASTE : 0) | (pad.vertical ? VERTICAL : 0) | (pad.mirror ? MIRROR : 0)
+                | (pad.double_ ? DOUBLE : 0);
+            p.lead = uint8_t(pad.land.lead);
+        }
+
+        // lines
+        f.lineBegin = w.lines.size();
+        f.lineCount = footprint.lines.size();
+        for (auto &line : footprint.lines) {
+            auto &l = w.lines.emplace_back();
+            l.layer = w.add(line.layer);
+            l.width = line.width;
+            l.pointBegin = w.points.size();
+            l.pointCount = line.points.size();
+            for (auto point : line.points)
+                w.points.push_back({point.x, point.y});
+        }
+
+        // circles
+        f.circleBegin = w.circles.size();
+        f.circleCount = footprint.circles.size();
+        for (auto &circle : footprint.circles) {
+            auto &c = w.circles.emplace_back();
+            c.layer = w.add(circle.layer);
+            c.width = circle.width;
+            set(c.center, circle.center);
+            c.radius = circle.radius;
+            c.fill = circle.fill;
+        }
+
+        // variants
+        auto &variants = footprint.variants;
+        f.variantPad = variants.pad;
+        f.valueBegin = w.values.size();
+        f.countCount = variants.counts.size();
+        f.rowsCount = variants.rows.size();
+        f.pitchCount = variants.pitches.size();
+        w.values.insert(w.values.end(), variants.counts.begin(), variants.counts.end());
+        w.values.insert(w.values.end(), variants.rows.begin(), variants.rows.end());
+        w.values.insert(w.values.end(), variants.pitches.begin(), variants.pitches.end());
+
+        // parameters and bindings of expressions
+        f.parameterBegin = w.parameters.size();
+        f.parameterCount = footprint.parameters.size();
+        for (auto &[name, value] : footprint.parameters)
+            w.parameters.push_back({w.add(name), value});
+        f.bindingBegin = w.bindings.size();
+        f.bindingCount = footprint.bindings.size();
+        for (auto &binding : footprint.bindings)
+            w.bindings.push_back({binding.pad, binding.component, w.add(binding.key), w.add(binding.source)});
+    }
+
+    // build file in memory
+    LibraryCache::Header header = {};
+    std::copy(CACHE_MAGIC, CACHE_MAGIC + 8, header.magic);
+    header.version = CACHE_VERSION;
+    header.endian = CACHE_ENDIAN;
+    header.sourceHash = sourceHash;
+    std::string buffer(sizeof(header), 0);
+    header.footprints = append(buffer, w.footprints.data(), w.footprints.size());
+    header.pads = append(buffer, w.pads.data(), w.pads.size());
+    header.lines = append(buffer, w.lines.data(), w.lines.size());
+    header.points = append(buffer, w.points.data(), w.points.size());
+    header.circles = append(buffer, w.circles.data(), w.circles.size());
+    header.names = append(buffer, w.names.data(), w.names.size());
+    header.values = append(buffer, w.values.data(), w.values.size());
+    header.parameters = append(buffer, w.parameters.data(), w.parameters.size());
+    header.bindings = append(buffer, w.bindings.data(), w.bindings.size());
+    header.strings = append(buffer, w.strings.data(), w.strings.size());
+    std::copy_n(reinterpret_cast<const char *>(&header), sizeof(header), buffer.begin());
+
+    // write to temporary file and rename so that a reader never sees a partial cache
+    fs::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream s(tempPath.string(), std::ios::binary);
+        s.write(buffer.data(), buffer.size());
+        s.close();
+        if (!s) {
+            std::cerr << "error: could not write cache " << path.string() << std::endl;
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        std::cerr << "error: could not write cache " << path.string() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool LibraryCache::open(const fs::path &path, uint64_t sourceHash) {
+    this->header = nullptr;
+    if (!this->file.open(path))
+        return false;
+    auto d = this->file.data();
+    if (d.size() < sizeof(Header))
+        return false;
+
+    // check header
+    auto header = reinterpret_cast<const Header *>(d.data());
+    if (!std::equal(CACHE_MAGIC, CACHE_MAGIC + 8, header->magic) || header->version != CACHE_VERSION
+        || header->endian != CACHE_ENDIAN || header->sourceHash != sourceHash)
+    {
+        return false;
+    }
+
+    // check arrays
+    if (!valid<FootprintRecord>(header->footprints, d.size()) || !valid<PadRecord>(header->pads, d.size())
+        || !valid<LineRecord>(header->lines, d.size()) || !valid<Point>(header->points, d.size())
+        || !valid<CircleRecord>(header->circles, d.size()) || !valid<StringRef>(header->names, d.size())
+        || !valid<double>(header->values, d.size()) || !valid<ParameterRecord>(header->parameters, d.size())
+        || !valid<BindingRecord>(header->bindings, d.size()) || !valid<char>(header->strings, d.size()))
+    {
+        return false;
+    }
+
+    // check ranges of the footprint records
+    auto footprints = data<FootprintRecord>(d.data(), header->footprints);
+    for (uint64_t i = 0; i < header->footprints.count; ++i) {
+        auto &f = footprints[i];
+        if (uint64_t(f.padBegin) + f.padCount > header->pads.count
+            || uint64_t(f.lineBegin) + f.lineCount > header->lines.count
+            || uint64_t(f.circleBegin) + f.circleCount > header->circles.count
+            || uint64_t(f.valueBegin) + f.countCount + f.rowsCount + f.pitchCount > header->values.count
+            || uint64_t(f.parameterBegin) + f.parameterCount > header->parameters.count
+            || uint64_t(f.bindingBegin) + f.bindingCount > header->bindings.count)
+        {
+            return false;
+        }
+    }
+
+    // check ranges of the pad names and line points
+    auto pads = data<PadRecord>(d.data(), header->pads);
+    for (uint64_t i = 0; i < header->pads.count; ++i) {
+        if (uint64_t(pads[i].nameBegin) + pads[i].nameCount > header->names.count)
+            return false;
+    }
+    auto lines = data<LineRecord>(d.data(), header->lines);
+    for (uint64_t i = 0; i < header->lines.count; ++i) {
+        if (uint64_t(lines[i].pointBegin) + lines[i].pointCount > header->points.count)
+            return false;
+    }
+
+    this->header = header;
+    return true;
+}
+
+int LibraryCache::size() const {
+    return this->header == nullptr ? 0 : int(this->header->footprints.count);
+}
+
+std::string_view LibraryCache::name(int index) const {
+    auto &f = data<FootprintRecord>(this->file.data().data(), this->header->footprints)[index];
+    return string(f.name.offset, f.name.length);
+}
+
+void LibraryCache::get(int index, Footprint &footprint) const {
+    const char *file = this->file.data().data();
+    auto &f = data<FootprintRecord>(file, this->header->footprints)[index];
+    footprint.template_ = f.template_;
+    footprint.description = string(f.description.offset, f.description.length);
+    footprint.inherit = string(f.inherit.offset, f.inherit.length);
+    footprint.type = Footprint::Type(f.type);
+    footprint.position = get2(f.position);
+    footprint.body.size = {f.body[0], f.body[1], f.body[2]};
+    footprint.body.offset = {f.body[3], f.body[4], f.body[5]};
+    footprint.silkscreen = f.silkscreen;
+    footprint.silkscreenAdd = get2(f.silkscreenAdd);
+    footprint.courtyard = f.courtyard;
+    footprint.courtyardAdd = get2(f.courtyardAdd);
+    footprint.orientation = Footprint::Orientation(f.orientation);
+    footprint.density = Footprint::Density(f.density);
+
+    // pads
+    auto pads = data<PadRecord>(file, this->header->pads) + f.padBegin;
+    auto names = data<StringRef>(file, this->header->names);
+    footprint.pads.resize(f.padCount);
+    for (uint32_t i = 0; i < f.padCount; ++i) {
+        auto &p = pads[i];
+        auto &pad = footprint.pads[i];
+        pad.type = Footprint::Pad::Type(p.type);
+        pad.position = get2(p.position);
+        pad.distance = get2(p.distance);
+        pad.pitch = p.pitch;
+        pad.shift = p.shift;
+        pad.size = get2(p.size);
+        pad.offset = get2(p.offset);
+        pad.shape = p.shape;
+        pad.drillSize = get2(p.drillSize);
+        pad.drillOffset = get2(p.drillOffset);
+        pad.clearance = p.clearance;
+        pad.maskMargin = p.maskMargin;
+        pad.land.lead = Footprint::Land::Lead(p.lead);
+        pad.land.span = get2(p.landSpan);
+        pad.land.terminal = get2(p.landTerminal);
+        pad.land.width = get2(p.landWidth);
+        pad.back = p.flags & BACK;
+        pad.jumper = p.flags & JUMPER;
+        pad.mask = p.flags & MASK;
+        pad.paste = p.flags & PASTE;
+        pad.vertical = p.flags & VERTICAL;
+        pad.count = p.count;
+        pad.mirror = p.flags & MIRROR;
+        pad.numbering = Footprint::Pad::Numbering(p.numbering);
+        pad.double_ = p.flags & DOUBLE;
+        pad.number = p.number;
+        pad.increment = p.increment;
+        pad.names.clear();
+        for (uint32_t j = 0; j < p.nameCount; ++j) {
+            auto &n = names[p.nameBegin + j];
+            pad.names.emplace_back(string(n.offset, n.length));
+        }
+    }
+
+    // lines
+    auto lines = data<LineRecord>(file, this->header->lines) + f.lineBegin;
+    auto points = data<Point>(file, this->header->points);
+    footprint.lines.resize(f.lineCount);
+    for (uint32_t i = 0; i < f.lineCount; ++i) {
+        auto &l = lines[i];
+        auto &line = footprint.lines[i];
+        line.layer = string(l.layer.offset, l.layer.length);
+        line.width = l.width;
+        line.points.clear();
+        for (uint32_t j = 0; j < l.pointCount; ++j) {
+            auto &p = points[l.pointBegin + j];
+            line.points.emplace_back(p.x, p.y);
+        }
+    }
+
+    // circles
+    auto circles = data<CircleRecord>(file, this->header->circles) + f.circleBegin;
+    footprint.circles.resize(f.circleCount);
+    for (uint32_t i = 0; i < f.circleCount; ++i) {
+        auto &c = circles[i];
+        auto &circle = footprint.circles[i];
+        circle.layer = string(c.layer.offset, c.layer.length);
+        circle.width = c.width;
+        circle.fill = c.fill;
+        circle.center = get2(c.center);
+        circle.radius = c.radius;
+    }
+
+    // variants
+    auto values = data<double>(file, this->header->values) + f.valueBegin;
+    auto &variants = footprint.variants;
+    variants.pad = f.variantPad;
+    variants.counts.assign(values, values + f.countCount);
+    values += f.countCount;
+    variants.rows.assign(values, values + f.rowsCount);
+    values += f.rowsCount;
+    variants.pitches.assign(values, values + f.pitchCount);
+
+    // parameters and bindings
+    auto parameters = data<ParameterRecord>(file, this->header->parameters) + f.parameterBegin;
+    footprint.parameters.clear();
+    for (uint32_t i = 0; i < f.parameterCount; ++i) {
+        auto &p = parameters[i];
+        footprint.parameters.emplace(string(p.name.offset, p.name.length), p.value);
+    }
+    auto bindings = data<BindingRecord>(file, this->header->bindings) + f.bindingBegin;
+    footprint.bindings.resize(f.bindingCount);
+    for (uint32_t i = 0; i < f.bindingCount; ++i) {
+        auto &b = bindings[i];
+        auto &binding = footprint.bindings[i];
+        binding.pad = b.pad;
+        binding.component = b.component;
+        binding.key = string(b.key.offset, b.key.length);
+        binding.source = string(b.source.offset, b.source.length);
+        std::string error;
+        binding.expression.compile(binding.source, error);
+    }
+}
+
+void LibraryCache::getAll(std::map<std::string, Footprint> &footprints) const {
+    int count = size();
+    for (int i = 0; i < count; ++i) {
+        // insert at end, footprints are sorted
+        auto it = footprints.emplace_hint(footprints.end(), name(i), Footprint());
+        get(i, it->second);
+    }
+}
+
+std::string_view LibraryCache::string(uint32_t offset, uint32_t length) const {
+    auto &strings = this->header->strings;
+    if (uint64_t(offset) + length > strings.count)
+        return {};
+    return {this->file.data().data() + strings.offset + offset, length};
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Footprint.hpp"
+#include "MappedFile.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+
+
+namespace fs = std::filesystem;
+
+
+// hash of the contents of a file (FNV-1a), used to detect if a cache is out of date
+uint64_t hashFile(const fs::path &path);
+
+// write resolved footprints to a binary cache file
+bool writeCache(const fs::path &path, uint64_t sourceHash, const std::map<std::string, Footprint> &footprints);
+
+
+// memory mapped binary cache of a resolved footprint library. Footprints are sorted by name and are decoded one by one
+// without parsing, all record ranges are checked when the cache is opened
+class LibraryCache {
+public:
+    struct Header;
+    struct FootprintRecord;
+
+    // open a cache file, returns false if it is missing, invalid or was not created from a source with given hash
+    bool open(const fs::path &path, uint64_t sourceHash);
+
+    // number of footprints
+    int size() const;
+
+    // name of footprint at given index
+    std::string_view name(int index) const;
+
+    // decode footprint at given index
+    void get(int index, Footprint &footprint) const;
+
+    // decode all footprints
+    void getAll(std::map<std::string, Footprint> &footprints) const;
+
+protected:
+    std::string_view string(uint32_t offset, uint32_t length) const;
+
+    MappedFile file;
+    const Header *header = nullptr;
+};
+
+// read all footprints from a cache file, returns false if the cache is missing, invalid or out of date
+inline bool readCache(const fs::path &path, uint64_t sourceHash, std::map<std::string, Footprint> &footprints) {
+    LibraryCache cache;
+    if (!cache.open(path, sourceHash))
+        return false;
+    cache.getAll(footprints);
+    return true;
+}
@@ -0,0 +1,253 @@
+#include "LibraryIndex.hpp"
+#include "expandVariant.hpp"
+#include <algorithm>
+#include <charconv>
+
+
+namespace {
+
+// tolerance for comparing numbers, e.g. a pitch of 0.5 given as expression may be 0.49999999
+constexpr double epsilon = 1e-6;
+
+struct OpName {
+    std::string_view name;
+    LibraryIndex::Op op;
+};
+
+// longer operators first so that "<=" is not parsed as "<"
+constexpr OpName opNames[] = {
+    {"!=", LibraryIndex::Op::NOT_EQUAL},
+    {"<=", LibraryIndex::Op::LESS_EQUAL},
+    {">=", LibraryIndex::Op::GREATER_EQUAL},
+    {"=", LibraryIndex::Op::EQUAL},
+    {"<", LibraryIndex::Op::LESS},
+    {">", LibraryIndex::Op::GREATER},
+};
+
+struct KeyName {
+    std::string_view name;
+    LibraryIndex::Key key;
+};
+
+constexpr KeyName keyNames[] = {
+    {"type", LibraryIndex::Key::TYPE},
+    {"pins", LibraryIndex::Key::PINS},
+    {"pitch", LibraryIndex::Key::PITCH},
+    {"body.x", LibraryIndex::Key::BODY_X},
+    {"body.y", LibraryIndex::Key::BODY_Y},
+    {"body.z", LibraryIndex::Key::BODY_Z},
+    {"parent", LibraryIndex::Key::PARENT},
+    {"inherits", LibraryIndex::Key::INHERITS},
+};
+
+int countPins(const Footprint &footprint) {
+    int count = 0;
+    for (auto &pad : footprint.pads) {
+        for (int i = 0; i < pad.count; ++i) {
+            if (pad.exists(pad.double_ ? i >> 1 : i))
+                ++count;
+        }
+    }
+    return count;
+}
+
+// entries of a sorted column in the range of a comparison
+void findRange(const std::vector<std::pair<double, int>> &column, LibraryIndex::Op op, double value,
+    std::vector<int> &result)
+{
+    using Op = LibraryIndex::Op;
+    auto begin = column.begin();
+    auto end = column.end();
+    auto lower = std::lower_bound(begin, end, value - epsilon, [](auto &a, double b) {return a.first < b;});
+    auto upper = std::upper_bound(begin, end, value + epsilon, [](double a, auto &b) {return a < b.first;});
+    auto add = [&result](auto first, auto last) {
+        for (auto it = first; it != last; ++it)
+            result.push_back(it->second);
+    };
+    switch (op) {
+    case Op::EQUAL:
+        add(lower, upper);
+        break;
+    case Op::NOT_EQUAL:
+        add(begin, lower);
+        add(upper, end);
+        break;
+    case Op::LESS:
+        add(begin, lower);
+        break;
+    case Op::LESS_EQUAL:
+        add(begin, upper);
+        break;
+    case Op::GREATER:
+        add(upper, end);
+        break;
+    case Op::GREATER_EQUAL:
+        add(lower, end);
+        break;
+    }
+}
+
+} // namespace
+
+
+bool LibraryIndex::parseFilter(std::string_view s, Filter &filter) {
+    // find the first operator
+    size_t pos = std::string_view::npos;
+    const OpName *opName = nullptr;
+    for (auto &o : opNames) {
+        size_t p = s.find(o.name);
+        if (p != std::string_view::npos && (p < pos || (p == pos && o.name.size() > opName->name.size()))) {
+            pos = p;
+            opName = &o;
+        }
+    }
+    if (opName == nullptr)
+        return false;
+    filter.op = opName->op;
+
+    auto key = s.substr(0, pos);
+    auto value = s.substr(pos + opName->name.size());
+    auto it = std::find_if(std::begin(keyNames), std::end(keyNames), [key](auto &k) {return k.name == key;});
+    if (it == std::end(keyNames))
+        return false;
+    filter.key = it->key;
+
+    // type and inheritance compare names, the other keys compare numbers
+    if (filter.key == Key::TYPE || filter.key == Key::PARENT || filter.key == Key::INHERITS) {
+        filter.text = value;
+        if (filter.key == Key::TYPE && value != "smd" && value != "through hole")
+            return false;
+        return !value.empty() && (filter.op == Op::EQUAL || filter.op == Op::NOT_EQUAL);
+    }
+    auto end = value.data() + value.size();
+    return !value.empty() && std::from_chars(value.data(), end, filter.value).ptr == end;
+}
+
+LibraryIndex::LibraryIndex(const std::map<std::string, Footprint> &footprints) {
+    auto add = [this](const std::string &footprintName, const std::string &name, const Footprint &footprint) {
+        int index = this->entries.size();
+        this->entries.push_back({name, footprint.inherit, footprint.getType()});
+        this->entriesByFootprint[footprintName].push_back(index);
+        this->pins.emplace_back(countPins(footprint), index);
+        for (auto &pad : footprint.pads) {
+            if (pad.count > 1)
+                this->pitches.emplace_back(pad.pitch, index);
+        }
+        this->bodyX.emplace_back(footprint.body.size.x, index);
+        this->bodyY.emplace_back(footprint.body.size.y, index);
+        this->bodyZ.emplace_back(footprint.body.size.z, index);
+    };
+
+    std::string variantName;
+    Footprint variant;
+    for (auto &[name, footprint] : footprints) {
+        if (!footprint.inherit.empty())
+            this->children[footprint.inherit].push_back(name);
+        if (footprint.template_)
+            continue;
+        if (footprint.variants.empty()) {
+            add(name, name, footprint);
+        } else {
+            int count = footprint.variants.size();
+            for (int i = 0; i < count; ++i) {
+                expandVariant(name, footprint, i, variantName, variant);
+                add(name, variantName, variant);
+            }
+        }
+    }
+
+    for (auto column : {&this->pins, &this->pitches, &this->bodyX, &this->bodyY, &this->bodyZ})
+        std::sort(column->begin(), column->end());
+}
+
+std::vector<std::string> LibraryIndex::query(const std::vector<Filter> &filters) const {
+    // intersect the entries that match each filter
+    std::vector<int> result(this->entries.size());
+    for (int i = 0; i < int(result.size()); ++i)
+        result[i] = i;
+    std::vector<int> intersection;
+    for (auto &filter : filters) {
+        auto found = find(filter);
+        intersection.clear();
+        std::set_intersection(result.begin(), result.end(), found.begin(), found.end(),
+            std::back_inserter(intersection));
+        result.swap(intersection);
+        if (result.empty())
+            break;
+    }
+
+    std::vector<std::string> names;
+    for (int index : result)
+        names.push_back(this->entries[index].name);
+    return names;
+}
+
+const LibraryIndex::Column &LibraryIndex::getColumn(Key key) const {
+    switch (key) {
+    case Key::PINS:
+        return this->pins;
+    case Key::PITCH:
+        return this->pitches;
+    case Key::BODY_X:
+        return this->bodyX;
+    case Key::BODY_Y:
+        return this->bodyY;
+    default:
+        return this->bodyZ;
+    }
+}
+
+std::vector<int> LibraryIndex::find(const Filter &filter) const {
+    std::vector<int> result;
+    bool equal = filter.op == Op::EQUAL;
+    switch (filter.key) {
+    case Key::TYPE: {
+        auto type = filter.text == "smd" ? Footprint::Type::SMD : Footprint::Type::THROUGH_HOLE;
+        for (int i = 0; i < int(this->entries.size()); ++i) {
+            if ((this->entries[i].type == type) == equal)
+                result.push_back(i);
+        }
+        return result;
+    }
+    case Key::PARENT:
+        for (int i = 0; i < int(this->entries.size()); ++i) {
+            if ((this->entries[i].parent == filter.text) == equal)
+                result.push_back(i);
+        }
+        return result;
+    case Key::INHERITS: {
+        // walk the inheritance tree down from the given footprint
+        std::vector<std::string_view> stack = {filter.text};
+        while (!stack.empty()) {
+            auto name = stack.back();
+            stack.pop_back();
+            auto it = this->children.find(name);
+            if (it == this->children.end())
+                continue;
+            for (auto &child : it->second) {
+                stack.push_back(child);
+                auto e = this->entriesByFootprint.find(child);
+                if (e != this->entriesByFootprint.end())
+                    result.insert(result.end(), e->second.begin(), e->second.end());
+            }
+        }
+        std::sort(result.begin(), result.end());
+        if (!equal) {
+            std::vector<int> all(this->entries.size());
+            for (int i = 0; i < int(all.size()); ++i)
+                all[i] = i;
+            std::vector<int> difference;
+            std::set_difference(all.begin(), all.end(), result.begin(), result.end(), std::back_inserter(difference));
+            return difference;
+        }
+        return result;
+    }
+    default:
+        findRange(getColumn(filter.key), filter.op, filter.value, result);
+
+        // a footprint may match with more than one pad array
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Footprint.hpp"
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// in-memory index over resolved footprints for filter queries, e.g. all footprints with 0.5mm pitch and more than 64
+// pins. Variants of footprint families are indexed individually, templates only take part in the inheritance
+class LibraryIndex {
+public:
+    enum class Key {
+        // smd or tht
+        TYPE,
+
+        // number of pads
+        PINS,
+
+        // pitch of any pad array
+        PITCH,
+
+        // body size
+        BODY_X,
+        BODY_Y,
+        BODY_Z,
+
+        // footprint given by inherit
+        PARENT,
+
+        // footprint that is inherited from directly or indirectly
+        INHERITS,
+    };
+
+    enum class Op {
+        EQUAL,
+        NOT_EQUAL,
+        LESS,
+        LESS_EQUAL,
+        GREATER,
+        GREATER_EQUAL,
+    };
+
+    struct Filter {
+        Key key;
+        Op op;
+        double value = 0;
+        std::string text;
+    };
+
+    // parse a filter such as "pitch=0.5", "pins>64", "body.z<=1.2", "type=smd" or "inherits=SOIC_template",
+    // returns false if invalid
+    static bool parseFilter(std::string_view s, Filter &filter);
+
+    // build the index, variants of footprint families get expanded
+    LibraryIndex(const std::map<std::string, Footprint> &footprints);
+
+    // get the names of all footprints that match all filters in the order of the library
+    std::vector<std::string> query(const std::vector<Filter> &filters) const;
+
+    // number of indexed footprints
+    size_t size() const {return this->entries.size();}
+
+protected:
+    struct Entry {
+        std::string name;
+        std::string parent;
+        Footprint::Type type;
+    };
+
+    // numeric column sorted by value, a footprint may have multiple values (e.g. one pitch per pad array)
+    using Column = std::vector<std::pair<double, int>>;
+
+    const Column &getColumn(Key key) const;
+    std::vector<int> find(const Filter &filter) const;
+
+    std::vector<Entry> entries;
+    Column pins;
+    Column pitches;
+    Column bodyX;
+    Column bodyY;
+    Column bodyZ;
+
+    // entries of a footprint or of all variants of a footprint family
+    std::map<std::string, std::vector<int>, std::less<>> entriesByFootprint;
+
+    // footprints that inherit from a footprint
+    std::map<std::string, std::vector<std::string>, std::less<>> children;
+};
@@ -0,0 +1,103 @@
+#include "MappedFile.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+bool MappedFile::open(const fs::path &path) {
+    close();
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    this->file = file;
+    this->opened = true;
+
+    // an empty file can't be mapped
+    if (size.QuadPart == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        close();
+        return false;
+    }
+    this->mapping = mapping;
+    this->begin = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (this->begin == nullptr) {
+        close();
+        return false;
+    }
+    this->size = size_t(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (this->begin != nullptr)
+        UnmapViewOfFile(this->begin);
+    if (this->mapping != nullptr)
+        CloseHandle(this->mapping);
+    if (this->file != nullptr)
+        CloseHandle(this->file);
+    this->opened = false;
+    this->begin = nullptr;
+    this->size = 0;
+    this->file = nullptr;
+    this->mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const fs::path &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    this->opened = true;
+
+    // an empty file can't be mapped
+    if (st.st_size > 0) {
+        void *begin = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (begin == MAP_FAILED) {
+            ::close(fd);
+            this->opened = false;
+            return false;
+        }
+        madvise(begin, st.st_size, MADV_SEQUENTIAL);
+        this->begin = static_cast<const char *>(begin);
+        this->size = st.st_size;
+    }
+
+    // the mapping stays valid after the file is closed
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close() {
+    if (this->begin != nullptr)
+        munmap(const_cast<char *>(this->begin), this->size);
+    this->opened = false;
+    this->begin = nullptr;
+    this->size = 0;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+
+namespace fs = std::filesystem;
+
+
+// read-only memory mapped file
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const fs::path &path) {open(path);}
+    MappedFile(const MappedFile &) = delete;
+    ~MappedFile() {close();}
+    MappedFile &operator =(const MappedFile &) = delete;
+
+    // map a file into memory, returns false if the file could not be opened
+    bool open(const fs::path &path);
+
+    // unmap the file
+    void close();
+
+    // check if the file is open (an empty file is open but has no data)
+    bool isOpen() const {return this->opened;}
+
+    // get contents of the file
+    std::string_view data() const {return {this->begin, this->size};}
+
+protected:
+    bool opened = false;
+    const char *begin = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#endif
+};
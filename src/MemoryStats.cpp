@@ -0,0 +1,242 @@
+#include "MemoryStats.hpp"
+#ifdef MEMORY_STATS
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#endif
+
+
+#ifdef MEMORY_STATS
+
+namespace {
+
+// allocation counters of a stage or a footprint
+struct Counters {
+    std::atomic<int64_t> allocations;
+    std::atomic<int64_t> bytes;
+    std::atomic<int64_t> live;
+    std::atomic<int64_t> peak;
+
+    void allocate(int64_t size) {
+        this->allocations.fetch_add(1, std::memory_order_relaxed);
+        this->bytes.fetch_add(size, std::memory_order_relaxed);
+        int64_t live = this->live.fetch_add(size, std::memory_order_relaxed) + size;
+        int64_t peak = this->peak.load(std::memory_order_relaxed);
+        while (live > peak && !this->peak.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+    }
+
+    void free(int64_t size) {
+        this->live.fetch_sub(size, std::memory_order_relaxed);
+    }
+};
+
+} // namespace
+
+struct FootprintMemory {
+    std::string name;
+    Counters counters;
+};
+
+namespace {
+
+// counters are constant initialized so that they can be used before static constructors run
+Counters total;
+Counters stages[int(MemoryStage::COUNT)];
+
+// footprints are never deleted because their allocations may be freed later
+std::mutex footprintMutex;
+std::vector<std::unique_ptr<FootprintMemory>> footprints;
+
+thread_local MemoryStage currentStage = MemoryStage::OTHER;
+thread_local FootprintMemory *currentFootprint = nullptr;
+
+// header in front of each allocation, keeps the alignment of operator new
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Header {
+    // size of the allocation in the lower 56 bits, stage in the upper 8 bits
+    uint64_t sizeAndStage;
+    FootprintMemory *footprint;
+};
+
+void *allocate(size_t size) {
+    auto header = static_cast<Header *>(std::malloc(sizeof(Header) + size));
+    if (header == nullptr)
+        return nullptr;
+    auto stage = currentStage;
+    auto footprint = currentFootprint;
+    header->sizeAndStage = uint64_t(size) | uint64_t(stage) << 56;
+    header->footprint = footprint;
+    total.allocate(size);
+    stages[int(stage)].allocate(size);
+    if (footprint != nullptr)
+        footprint->counters.allocate(size);
+    return header + 1;
+}
+
+void deallocate(void *p) {
+    if (p == nullptr)
+        return;
+    auto header = static_cast<Header *>(p) - 1;
+    int64_t size = header->sizeAndStage & 0x00ffffffffffffff;
+    total.free(size);
+    stages[header->sizeAndStage >> 56].free(size);
+    if (header->footprint != nullptr)
+        header->footprint->counters.free(size);
+    std::free(header);
+}
+
+const char *stageNames[] = {"other", "parse", "resolve", "layout", "clip", "format", "vrml", "step"};
+
+void printCounters(std::ostream &s, const char *name, const Counters &counters) {
+    s << std::left << std::setw(24) << name << std::right
+        << std::setw(14) << counters.allocations.load()
+        << std::setw(16) << counters.bytes.load()
+        << std::setw(16) << counters.peak.load()
+        << std::setw(16) << counters.live.load() << '\n';
+}
+
+FootprintMemory *addFootprint(const std::string &name) {
+    auto footprint = std::make_unique<FootprintMemory>();
+    footprint->name = name;
+    auto result = footprint.get();
+    std::lock_guard<std::mutex> lock(footprintMutex);
+    footprints.push_back(std::move(footprint));
+    return result;
+}
+
+} // namespace
+
+
+MemoryAccount::MemoryAccount(const std::string &footprintName)
+    : footprint(addFootprint(footprintName))
+{
+}
+
+MemoryScope::MemoryScope(MemoryStage stage)
+    : previousStage(currentStage), previousFootprint(currentFootprint), footprint(currentFootprint)
+{
+    currentStage = stage;
+}
+
+MemoryScope::MemoryScope(MemoryStage stage, const std::string &footprintName)
+    : previousStage(currentStage), previousFootprint(currentFootprint), footprint(addFootprint(footprintName))
+{
+    currentStage = stage;
+    currentFootprint = this->footprint;
+}
+
+MemoryScope::MemoryScope(MemoryStage stage, const MemoryScope &parent)
+    : previousStage(currentStage), previousFootprint(currentFootprint), footprint(parent.footprint)
+{
+    currentStage = stage;
+    currentFootprint = this->footprint;
+}
+
+MemoryScope::MemoryScope(MemoryStage stage, const MemoryAccount &parent)
+    : previousStage(currentStage), previousFootprint(currentFootprint), footprint(parent.footprint)
+{
+    currentStage = stage;
+    currentFootprint = this->footprint;
+}
+
+MemoryScope::~MemoryScope() {
+    currentStage = this->previousStage;
+    currentFootprint = this->previousFootprint;
+}
+
+void printMemoryStats(std::ostream &s, int top) {
+    s << std::left << std::setw(24) << "stage" << std::right
+        << std::setw(14) << "allocations"
+        << std::setw(16) << "bytes"
+        << std::setw(16) << "peak"
+        << std::setw(16) << "live" << '\n';
+    for (int i = 0; i < int(MemoryStage::COUNT); ++i)
+        printCounters(s, stageNames[i], stages[i]);
+    printCounters(s, "total", total);
+    s << "note: only operator new is counted, allocations of OpenCASCADE (malloc) in the vrml and step stages are "
+        "missing\n";
+
+    // footprints with the highest peak memory
+    std::vector<const FootprintMemory *> list;
+    {
+        std::lock_guard<std::mutex> lock(footprintMutex);
+        for (auto &footprint : footprints)
+            list.push_back(footprint.get());
+    }
+    top = std::min(top, int(list.size()));
+    std::partial_sort(list.begin(), list.begin() + top, list.end(),
+        [](const FootprintMemory *a, const FootprintMemory *b) {
+            return a->counters.peak.load() > b->counters.peak.load();
+        });
+    if (top > 0) {
+        s << '\n' << std::left << std::setw(24) << "footprint" << std::right
+            << std::setw(14) << "allocations"
+            << std::setw(16) << "bytes"
+            << std::setw(16) << "peak"
+            << std::setw(16) << "live" << '\n';
+        for (int i = 0; i < top; ++i)
+            printCounters(s, list[i]->name.c_str(), list[i]->counters);
+    }
+}
+
+
+// replace global operator new and delete, the aligned variants are not replaced and are not accounted. malloc is not
+// replaced either, therefore OpenCASCADE (Standard::Allocate) is not accounted
+
+void *operator new(size_t size) {
+    void *p = allocate(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    void *p = allocate(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void *p) noexcept {
+    deallocate(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    deallocate(p);
+}
+
+#else
+
+void printMemoryStats(std::ostream &s, int top) {
+    s << "warning: memory statistics are not available, configure with -DMEMORY_STATS=ON" << std::endl;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+
+// stages of the pipeline to which allocations are accounted
+enum class MemoryStage : uint8_t {
+    OTHER,
+    PARSE, // parsing the json file or reading the cache
+    RESOLVE, // resolving inherit, expressions and variants
+    LAYOUT, // placing the pads
+    CLIP, // clipping the silkscreen
+    FORMAT, // writing kicad, svg and xml
+    VRML, // tessellating and writing vrml
+    STEP, // writing step
+    COUNT
+};
+
+struct FootprintMemory;
+
+#ifdef MEMORY_STATS
+
+// record to which the allocations of a footprint are accounted, e.g. one for all output tasks of a footprint. Records
+// are never deleted, so a copy of the account stays valid
+class MemoryAccount {
+public:
+    MemoryAccount() = default;
+    explicit MemoryAccount(const std::string &footprintName);
+
+protected:
+    friend class MemoryScope;
+    FootprintMemory *footprint = nullptr;
+};
+
+// accounts the allocations of the current thread to a stage and optionally to a footprint until the scope ends. Only
+// available if configured with -DMEMORY_STATS=ON which replaces the global operator new and delete, allocations with
+// malloc (e.g. by OpenCASCADE) are not accounted
+class MemoryScope {
+public:
+    // account to a stage, the current footprint remains
+    explicit MemoryScope(MemoryStage stage);
+
+    // account to a stage and a footprint
+    MemoryScope(MemoryStage stage, const std::string &footprintName);
+
+    // account to a stage and the footprint of a scope of another thread, e.g. for worker threads of a footprint
+    MemoryScope(MemoryStage stage, const MemoryScope &parent);
+
+    // account to a stage and an existing footprint record, e.g. for the tasks of a footprint
+    MemoryScope(MemoryStage stage, const MemoryAccount &parent);
+
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope &) = delete;
+    MemoryScope &operator =(const MemoryScope &) = delete;
+
+protected:
+    MemoryStage previousStage;
+    FootprintMemory *previousFootprint;
+    FootprintMemory *footprint;
+};
+
+#else
+
+class MemoryAccount {
+public:
+    MemoryAccount() = default;
+    explicit MemoryAccount(const std::string &footprintName) {}
+};
+
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryStage stage) {}
+    MemoryScope(MemoryStage stage, const std::string &footprintName) {}
+    MemoryScope(MemoryStage stage, const MemoryScope &parent) {}
+    MemoryScope(MemoryStage stage, const MemoryAccount &parent) {}
+};
+
+#endif
+
+// print allocations, bytes and peak memory per stage and the footprints with the highest peak memory
+void printMemoryStats(std::ostream &s, int top = 10);
@@ -0,0 +1,148 @@
+#include "FootprintSink.hpp"
+#include "generateVrml.hpp"
+#include "GzipStream.hpp"
+#include "MemoryStats.hpp"
+#include "Reporter.hpp"
+#include "StepPlugin.hpp"
+#include <array>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+
+// tessellated body
+struct Mesh {
+    std::vector<double3> points;
+    std::vector<int> triangles;
+};
+
+// cache of tessellated bodies, bodies of the same size share one mesh
+static std::mutex meshMutex;
+static std::map<std::array<double, 4>, std::shared_ptr<const Mesh>> meshes;
+
+static std::shared_ptr<const Mesh> getMesh(const StepPlugin &plugin, double3 size, double deflection) {
+    std::array<double, 4> key = {size.x, size.y, size.z, deflection};
+    {
+        std::lock_guard<std::mutex> lock(meshMutex);
+        auto it = meshes.find(key);
+        if (it != meshes.end())
+            return it->second;
+    }
+
+    // tessellate outside of the lock, if two threads tessellate the same body the first one wins
+    auto mesh = std::make_shared<Mesh>();
+    if (!plugin.tessellateBody(size, deflection, mesh->points, mesh->triangles))
+        mesh = nullptr;
+    std::lock_guard<std::mutex> lock(meshMutex);
+    return meshes.emplace(key, std::move(mesh)).first->second;
+}
+
+// the built-in box is used for vrml models, warn once because the geometry differs from the step model
+static void warnBuiltInBox(const char *reason) {
+    static std::once_flag flag;
+    std::call_once(flag, [reason] {
+        reportWarning({}, std::string("vrml models are built-in boxes instead of tessellated models, ") + reason);
+    });
+}
+
+// writes the body as vrml (.wrl or gzip compressed .wrz). The body is tessellated by the step plugin, if the plugin
+// is disabled or not available a built-in box is used
+class VrmlSink : public FootprintSink {
+public:
+    VrmlSink(const fs::path &dir, Output &output, const SinkOptions &options)
+        : dir(dir), output(output), usePlugin(options.usePlugin), deflection(options.deflection)
+        , compress(options.compressVrml), extension(options.getVrmlExtension()) {}
+
+    void begin(const std::string &name, const Footprint &footprint, bool haveBody) override {
+        this->name = name;
+        this->haveBody = false;
+    }
+
+    void body(double3 center, double3 size) override {
+        MemoryScope scope(MemoryStage::VRML);
+        auto plugin = this->usePlugin ? getStepPlugin() : nullptr;
+        auto mesh = plugin != nullptr ? getMesh(*plugin, size, this->deflection) : nullptr;
+        if (!this->usePlugin)
+            warnBuiltInBox("the step plugin is disabled (--no-step without --tessellate or --no-plugin)");
+        else if (plugin == nullptr)
+            warnBuiltInBox("the step plugin is not available");
+        else if (mesh == nullptr)
+            reportWarning(this->name, "tessellation failed, the vrml model is a built-in box");
+        auto write = [&](std::ostream &s) {
+            if (mesh != nullptr)
+                writeVrml(s, center, mesh->points, mesh->triangles);
+            else
+                generateVrml(s, center, size);
+        };
+        if (this->compress) {
+            // compress while writing
+            GzipStream s;
+            write(s);
+            this->data = s.finish();
+        } else {
+            std::ostringstream s;
+            write(s);
+            this->data = std::move(s).str();
+        }
+        this->haveBody = true;
+    }
+
+    void end() override {
+        if (this->haveBody)
+            this->output.write(this->dir / (this->name + this->extension), std::move(this->data));
+    }
+
+protected:
+    fs::path dir;
+    Output &output;
+    bool usePlugin;
+    double deflection;
+    bool compress;
+    const char *extension;
+    std::string name;
+    bool haveBody = false;
+    std::string data;
+};
+
+// writes the body as step (.step) using the step plugin
+class StepSink : public FootprintSink {
+public:
+    StepSink(const fs::path &dir, Output &output) : dir(dir), output(output) {}
+
+    void begin(const std::string &name, const Footprint &footprint, bool haveBody) override {
+        this->name = name;
+        this->haveBody = false;
+    }
+
+    void body(double3 center, double3 size) override {
+        MemoryScope scope(MemoryStage::STEP);
+
+        // the plugin is loaded when the first step file is generated
+        auto plugin = getStepPlugin();
+        if (plugin == nullptr)
+            return;
+        std::ostringstream s;
+        this->haveBody = plugin->generateStep(s, center, size);
+        this->data = std::move(s).str();
+    }
+
+    void end() override {
+        if (this->haveBody)
+            this->output.write(this->dir / (this->name + ".step"), std::move(this->data));
+    }
+
+protected:
+    fs::path dir;
+    Output &output;
+    std::string name;
+    bool haveBody = false;
+    std::string data;
+};
+
+std::unique_ptr<FootprintSink> createVrmlSink(const fs::path &dir, Output &output, const SinkOptions &options) {
+    return std::make_unique<VrmlSink>(dir, output, options);
+}
+
+std::unique_ptr<FootprintSink> createStepSink(const fs::path &dir, Output &output) {
+    return std::make_unique<StepSink>(dir, output);
+}
@@ -0,0 +1,473 @@
+#include "Output.hpp"
+#include "Reporter.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+Output::~Output() {
+}
+
+void Output::write(int sequence, fs::path path, std::string data) {
+    write(std::move(path), std::move(data));
+}
+
+void Output::complete(int sequence) {
+}
+
+namespace {
+
+// file waiting to be written
+struct File {
+    fs::path path;
+    std::string data;
+};
+
+// output with a queue that is processed in batches by a background thread
+class QueuedOutput : public Output {
+public:
+    ~QueuedOutput() override {
+        stop();
+    }
+
+    void write(fs::path path, std::string data) override {
+        {
+            std::lock_guard lock(this->mutex);
+            this->queue.push_back({std::move(path), std::move(data)});
+        }
+        this->condition.notify_one();
+    }
+
+    bool finish() override {
+        stop();
+        return this->success;
+    }
+
+    // start the background thread
+    void start() {
+        this->thread = std::thread([this] {run();});
+    }
+
+protected:
+    // write a batch of files, returns false if a file could not be written
+    virtual bool writeBatch(std::vector<File> &files) = 0;
+
+    void stop() {
+        if (this->thread.joinable()) {
+            {
+                std::lock_guard lock(this->mutex);
+                this->stopping = true;
+            }
+            this->condition.notify_one();
+            this->thread.join();
+        }
+    }
+
+    void run() {
+        std::vector<File> batch;
+        while (true) {
+            {
+                std::unique_lock lock(this->mutex);
+                this->condition.wait(lock, [this] {return this->stopping || !this->queue.empty();});
+                if (this->queue.empty())
+                    break;
+
+                // take all queued files as one batch
+                batch.swap(this->queue);
+            }
+            if (!writeBatch(batch))
+                this->success = false;
+            batch.clear();
+        }
+    }
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<File> queue;
+    bool stopping = false;
+    bool success = true;
+};
+
+// write files with plain blocking I/O, returns false if a file could not be written
+bool writeFiles(File *files, size_t count) {
+    bool success = true;
+    for (size_t i = 0; i < count; ++i) {
+        auto &file = files[i];
+        std::ofstream s(file.path.string(), std::ios::binary);
+        s.write(file.data.data(), file.data.size());
+        s.close();
+        if (!s) {
+            reportError({}, "could not write file " + file.path.string());
+            success = false;
+        }
+    }
+    return success;
+}
+
+// plain blocking I/O in the background thread
+class BlockingOutput : public QueuedOutput {
+public:
+    ~BlockingOutput() override {
+        stop();
+    }
+
+protected:
+    bool writeBatch(std::vector<File> &files) override {
+        return writeFiles(files.data(), files.size());
+    }
+};
+
+#ifdef HAVE_LIBURING
+
+// batched I/O using io_uring: all files of a batch are opened, written and closed with one submission each
+class UringOutput : public QueuedOutput {
+public:
+    static constexpr unsigned QUEUE_SIZE = 256;
+
+    ~UringOutput() override {
+        stop();
+        if (this->initialized)
+            io_uring_queue_exit(&this->ring);
+    }
+
+    bool init() {
+        this->initialized = io_uring_queue_init(QUEUE_SIZE, &this->ring, 0) == 0;
+        return this->initialized;
+    }
+
+protected:
+    // submit count operations prepared by the prep function and wait for all results. Returns false if the ring
+    // failed, then it is not used anymore
+    template <typename F>
+    bool submit(size_t count, std::vector<int> &results, F prep) {
+        results.assign(count, -1);
+        for (size_t i = 0; i < count; ++i) {
+            io_uring_sqe *sqe = io_uring_get_sqe(&this->ring);
+            prep(sqe, i);
+            io_uring_sqe_set_data64(sqe, i);
+        }
+
+        // the kernel may take less operations than prepared, the rest is submitted again
+        size_t submitted = 0;
+        bool success = true;
+        while (submitted < count) {
+            int result = io_uring_submit_and_wait(&this->ring, unsigned(count - submitted));
+            if (result == -EINTR)
+                continue;
+            if (result <= 0) {
+                success = false;
+                break;
+            }
+            submitted += result;
+        }
+
+        // drain all completions of the submitted operations so that none is left for the next submission
+        size_t completed = 0;
+        while (completed < submitted) {
+            io_uring_cqe *cqe;
+            int result = io_uring_wait_cqe(&this->ring, &cqe);
+            if (result == -EINTR)
+                continue;
+            if (result != 0)
+                return false;
+            results[io_uring_cqe_get_data64(cqe)] = cqe->res;
+            io_uring_cqe_seen(&this->ring, cqe);
+            ++completed;
+        }
+        return success;
+    }
+
+    bool writeBatch(std::vector<File> &files) override {
+        bool success = true;
+        for (size_t begin = 0; begin < files.size(); begin += QUEUE_SIZE) {
+            File *chunk = files.data() + begin;
+            size_t count = std::min(files.size() - begin, size_t(QUEUE_SIZE));
+            if (!this->failed) {
+                if (writeChunk(chunk, count, success))
+                    continue;
+                reportWarning({}, "io_uring failed, files are written with blocking I/O");
+                this->failed = true;
+            }
+
+            // write the chunk again with blocking I/O
+            if (!writeFiles(chunk, count))
+                success = false;
+        }
+        return success;
+    }
+
+    // write a chunk of at most QUEUE_SIZE files, returns false if the ring failed
+    bool writeChunk(File *chunk, size_t count, bool &success) {
+        std::vector<int> fds;
+        std::vector<int> results;
+        std::vector<size_t> written;
+        std::vector<size_t> pending;
+
+        // close the files that were opened if the ring fails before they are closed by the ring
+        auto closeFiles = [&fds] {
+            for (int fd : fds) {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+        };
+
+        // open all files of the chunk
+        if (!submit(count, fds, [chunk](io_uring_sqe *sqe, size_t i) {
+            io_uring_prep_openat(sqe, AT_FDCWD, chunk[i].path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+        })) {
+            closeFiles();
+            return false;
+        }
+
+        // write until all data is written (a write may be short)
+        written.assign(count, 0);
+        for (size_t i = 0; i < count; ++i) {
+            if (fds[i] < 0) {
+                reportError({}, "could not create file " + chunk[i].path.string());
+                success = false;
+            } else if (!chunk[i].data.empty()) {
+                pending.push_back(i);
+            }
+        }
+        while (!pending.empty()) {
+            if (!submit(pending.size(), results, [&](io_uring_sqe *sqe, size_t j) {
+                size_t i = pending[j];
+                auto &data = chunk[i].data;
+                io_uring_prep_write(sqe, fds[i], data.data() + written[i], data.size() - written[i], written[i]);
+            })) {
+                closeFiles();
+                return false;
+            }
+            size_t k = 0;
+            for (size_t j = 0; j < pending.size(); ++j) {
+                size_t i = pending[j];
+                if (results[j] <= 0) {
+                    reportError({}, "could not write file " + chunk[i].path.string());
+                    success = false;
+                    continue;
+                }
+                written[i] += results[j];
+                if (written[i] < chunk[i].data.size())
+                    pending[k++] = i;
+            }
+            pending.resize(k);
+        }
+
+        // close all files of the chunk. If this fails, it is unknown which files are closed, they are not closed again
+        // because a file descriptor may already be reused
+        return submit(count, results, [&fds](io_uring_sqe *sqe, size_t i) {
+            if (fds[i] >= 0)
+                io_uring_prep_close(sqe, fds[i]);
+            else
+                io_uring_prep_nop(sqe);
+        });
+    }
+
+    io_uring ring;
+    bool initialized = false;
+
+    // the ring failed, remaining files are written with blocking I/O
+    bool failed = false;
+};
+
+#endif
+
+// tar archive (ustar with pax headers for long names). Files are collected per footprint and released to the
+// background thread in the order of the sequence numbers
+class TarOutput : public QueuedOutput {
+public:
+    TarOutput(std::FILE *file, const fs::path &dir) : file(file), dir(dir) {
+        // reproducible timestamps
+        const char *epoch = std::getenv("SOURCE_DATE_EPOCH");
+        this->mtime = epoch != nullptr ? std::strtoll(epoch, nullptr, 10) : 0;
+    }
+
+    ~TarOutput() override {
+        stop();
+        if (this->file != stdout)
+            std::fclose(this->file);
+    }
+
+    void write(int sequence, fs::path path, std::string data) override {
+        std::lock_guard lock(this->orderMutex);
+        this->pending[sequence].push_back({std::move(path), std::move(data)});
+    }
+
+    void complete(int sequence) override {
+        std::lock_guard lock(this->orderMutex);
+        this->completed.insert(sequence);
+
+        // release all footprints that are complete and have no unfinished predecessor
+        while (true) {
+            auto it = this->completed.find(this->next);
+            if (it == this->completed.end())
+                break;
+            this->completed.erase(it);
+            release(this->next);
+            ++this->next;
+        }
+    }
+
+    bool finish() override {
+        {
+            // release remaining footprints in order
+            std::lock_guard lock(this->orderMutex);
+            while (!this->pending.empty())
+                release(this->pending.begin()->first);
+        }
+        stop();
+
+        // end of archive: two zero blocks
+        char zero[1024] = {};
+        std::fwrite(zero, 1, sizeof(zero), this->file);
+        if (std::fflush(this->file) != 0 || std::ferror(this->file)) {
+            reportError({}, "could not write tar archive");
+            this->success = false;
+        }
+        return this->success;
+    }
+
+protected:
+    void release(int sequence) {
+        auto it = this->pending.find(sequence);
+        if (it == this->pending.end())
+            return;
+
+        // the outputs of a footprint are generated in parallel, sort them by name
+        auto &files = it->second;
+        std::sort(files.begin(), files.end(), [](const File &a, const File &b) {return a.path < b.path;});
+        for (auto &file : files)
+            QueuedOutput::write(std::move(file.path), std::move(file.data));
+        this->pending.erase(it);
+    }
+
+    // write a header block
+    void writeHeader(std::string_view name, size_t size, char type) {
+        char header[512] = {};
+        std::memcpy(header, name.data(), std::min(name.size(), size_t(100)));
+        std::snprintf(header + 100, 8, "%07o", 0644); // mode
+        std::snprintf(header + 108, 8, "%07o", 0); // uid
+        std::snprintf(header + 116, 8, "%07o", 0); // gid
+        std::snprintf(header + 124, 12, "%011llo", (unsigned long long)size);
+        std::snprintf(header + 136, 12, "%011llo", (unsigned long long)this->mtime);
+        header[156] = type;
+        std::memcpy(header + 257, "ustar", 6);
+        std::memcpy(header + 263, "00", 2);
+
+        // checksum is calculated with the checksum field set to spaces
+        std::memset(header + 148, ' ', 8);
+        unsigned checksum = 0;
+        for (unsigned char c : header)
+            checksum += c;
+        std::snprintf(header + 148, 8, "%06o", checksum);
+        std::fwrite(header, 1, sizeof(header), this->file);
+    }
+
+    // write data padded to a multiple of the block size
+    void writeData(std::string_view data) {
+        std::fwrite(data.data(), 1, data.size(), this->file);
+        char zero[512] = {};
+        std::fwrite(zero, 1, (512 - data.size() % 512) % 512, this->file);
+    }
+
+    bool writeBatch(std::vector<File> &files) override {
+        for (auto &file : files) {
+            std::string name = file.path.lexically_relative(this->dir).generic_string();
+            if (name.size() > 100) {
+                // pax extended header for the long name, the length of a record includes the length itself
+                std::string record = " path=" + name + "\n";
+                size_t length = record.size() + 1;
+                while (std::to_string(length).size() + record.size() > length)
+                    ++length;
+                record = std::to_string(length) + record;
+                writeHeader("PaxHeader", record.size(), 'x');
+                writeData(record);
+            }
+            writeHeader(name, file.data.size(), '0');
+            writeData(file.data);
+        }
+        return !std::ferror(this->file);
+    }
+
+    std::FILE *file;
+    fs::path dir;
+    long long mtime;
+
+    // files of footprints that are not yet released
+    std::mutex orderMutex;
+    std::map<int, std::vector<File>> pending;
+    std::set<int> completed;
+    int next = 0;
+};
+
+} // namespace
+
+
+void MemoryOutput::write(fs::path path, std::string data) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->files[path.generic_string()] = std::move(data);
+}
+
+bool MemoryOutput::finish() {
+    return true;
+}
+
+std::map<std::string, std::string> MemoryOutput::take() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return std::move(this->files);
+}
+
+std::unique_ptr<Output> createFileOutput() {
+#ifdef HAVE_LIBURING
+    // io_uring may be unavailable at runtime (old kernel, disabled by seccomp)
+    auto uring = std::make_unique<UringOutput>();
+    if (uring->init()) {
+        uring->start();
+        return uring;
+    }
+#endif
+    auto output = std::make_unique<BlockingOutput>();
+    output->start();
+    return output;
+}
+
+std::unique_ptr<Output> createTarOutput(const fs::path &path, const fs::path &dir) {
+    std::FILE *file;
+    if (path == "-") {
+        file = stdout;
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    } else {
+        file = std::fopen(path.string().c_str(), "wb");
+        if (file == nullptr) {
+            std::cerr << "error: could not create file " << path.string() << std::endl;
+            return nullptr;
+        }
+    }
+    auto output = std::make_unique<TarOutput>(file, dir);
+    output->start();
+    return output;
+}
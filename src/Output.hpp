@@ -0,0 +1,73 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+
+namespace fs = std::filesystem;
+
+
+// output of generated files, writing is done asynchronously so that generation never waits for the disk
+class Output {
+public:
+    virtual ~Output();
+
+    // queue a file for writing, returns immediately
+    virtual void write(fs::path path, std::string data) = 0;
+
+    // queue a file of the footprint with given sequence number. Footprints are numbered in the order of the library,
+    // outputs that write a single stream (tar) keep this order although footprints are generated in parallel
+    virtual void write(int sequence, fs::path path, std::string data);
+
+    // all files of the footprint with given sequence number have been queued
+    virtual void complete(int sequence);
+
+    // wait until all queued files are written, returns false if a file could not be written. No files can be
+    // written after calling finish()
+    virtual bool finish() = 0;
+};
+
+// output of a worker thread that passes the sequence number of the current footprint to the actual output
+class SequencedOutput : public Output {
+public:
+    explicit SequencedOutput(Output &output) : output(output) {}
+
+    void write(fs::path path, std::string data) override {
+        this->output.write(this->sequence, std::move(path), std::move(data));
+    }
+
+    // the actual output is finished by its owner
+    bool finish() override {return true;}
+
+    // sequence number of the current footprint
+    int sequence = 0;
+
+protected:
+    Output &output;
+};
+
+// output that keeps the files in memory, e.g. for the python module
+class MemoryOutput : public Output {
+public:
+    void write(fs::path path, std::string data) override;
+    bool finish() override;
+
+    // take the written files, the key is the path
+    std::map<std::string, std::string> take();
+
+protected:
+    std::mutex mutex;
+    std::map<std::string, std::string> files;
+};
+
+// create an output that writes files in batches using io_uring if available, otherwise using blocking I/O in a
+// background thread
+std::unique_ptr<Output> createFileOutput();
+
+// create an output that writes all files as entries of a tar archive to a file or to stdout if the path is "-". The
+// entries are named relative to dir and are written in the order of the footprints as soon as they are complete.
+// Timestamps are SOURCE_DATE_EPOCH or 0 so that the archive is reproducible
+std::unique_ptr<Output> createTarOutput(const fs::path &path, const fs::path &dir);
@@ -0,0 +1,271 @@
+#include "Reporter.hpp"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class EventType {
+    FOOTPRINT,
+    WARNING,
+    ERROR,
+};
+
+struct Event {
+    Event *next;
+    EventType type;
+    double time;
+    std::string footprint;
+    std::string message;
+};
+
+// interval of the progress line and of writing the log
+constexpr auto interval = std::chrono::milliseconds(100);
+
+// lock-free list of events in reverse order
+std::atomic<Event *> events = nullptr;
+
+std::atomic<size_t> footprintCount = 0;
+std::atomic<size_t> warningCount = 0;
+std::atomic<size_t> errorCount = 0;
+std::atomic<size_t> total = 0;
+
+std::atomic<bool> running = false;
+Clock::time_point startTime;
+std::thread thread;
+std::mutex mutex;
+std::condition_variable condition;
+bool stopping = false;
+bool progress = false;
+std::ofstream logFile;
+
+// errors of the current thread are captured if not null
+thread_local ErrorCapture *errorCapture = nullptr;
+
+// print a warning or an error
+void print(const Event &event) {
+    std::string line = event.type == EventType::WARNING ? "warning: " : "error: ";
+    if (!event.footprint.empty()) {
+        line += event.footprint;
+        line += ": ";
+    }
+    line += event.message;
+    line += '\n';
+    std::cerr << line;
+}
+
+void push(EventType type, std::string_view footprint, std::string_view message) {
+    if (!running.load(std::memory_order_acquire)) {
+        if (type != EventType::FOOTPRINT)
+            print({nullptr, type, 0, std::string(footprint), std::string(message)});
+        return;
+    }
+    double time = std::chrono::duration<double>(Clock::now() - startTime).count();
+    auto event = new Event{nullptr, type, time, std::string(footprint), std::string(message)};
+    event->next = events.load(std::memory_order_relaxed);
+    while (!events.compare_exchange_weak(event->next, event, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// length of the progress line that is currently shown
+size_t progressLength = 0;
+
+void clearProgress() {
+    if (progressLength > 0) {
+        std::cerr << '\r' << std::string(progressLength, ' ') << '\r';
+        progressLength = 0;
+    }
+}
+
+void printProgress() {
+    std::string line = std::to_string(footprintCount.load(std::memory_order_relaxed));
+    size_t t = total.load(std::memory_order_relaxed);
+    if (t > 0)
+        line += "/" + std::to_string(t);
+    line += " footprints";
+    size_t w = warningCount.load(std::memory_order_relaxed);
+    size_t e = errorCount.load(std::memory_order_relaxed);
+    if (w > 0)
+        line += ", " + std::to_string(w) + " warnings";
+    if (e > 0)
+        line += ", " + std::to_string(e) + " errors";
+    std::cerr << '\r' << line;
+    if (line.size() < progressLength)
+        std::cerr << std::string(progressLength - line.size(), ' ');
+    std::cerr << std::flush;
+    progressLength = line.size();
+}
+
+// print and log all events that were pushed so far, in the order they were pushed
+void drain() {
+    Event *list = events.exchange(nullptr, std::memory_order_acquire);
+    Event *reversed = nullptr;
+    while (list != nullptr) {
+        Event *next = list->next;
+        list->next = reversed;
+        reversed = list;
+        list = next;
+    }
+
+    bool cleared = false;
+    while (reversed != nullptr) {
+        Event *event = reversed;
+        reversed = event->next;
+        if (event->type != EventType::FOOTPRINT) {
+            // the progress line gets printed again after the messages
+            if (!cleared) {
+                clearProgress();
+                cleared = true;
+            }
+            print(*event);
+        }
+        if (logFile.is_open()) {
+            nlohmann::json j;
+            j["time"] = event->time;
+            if (event->type == EventType::FOOTPRINT) {
+                j["event"] = "footprint";
+                j["name"] = event->footprint;
+            } else {
+                j["event"] = event->type == EventType::WARNING ? "warning" : "error";
+                if (!event->footprint.empty())
+                    j["footprint"] = event->footprint;
+                j["message"] = event->message;
+            }
+            logFile << j.dump() << '\n';
+        }
+        delete event;
+    }
+}
+
+void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        condition.wait_for(lock, interval);
+        drain();
+        if (progress)
+            printProgress();
+    }
+}
+
+} // namespace
+
+
+bool startReporter(const fs::path &logPath) {
+    if (!logPath.empty()) {
+        logFile.open(logPath.string());
+        if (!logFile.is_open()) {
+            std::cerr << "error: could not create file " << logPath.string() << '\n';
+            return false;
+        }
+    }
+    startTime = Clock::now();
+    progress = isatty(fileno(stderr));
+    stopping = false;
+    running.store(true, std::memory_order_release);
+    thread = std::thread(run);
+    return true;
+}
+
+void stopReporter() {
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_one();
+    thread.join();
+
+    // events that are pushed from now on are printed directly
+    running.store(false, std::memory_order_release);
+    drain();
+    clearProgress();
+
+    // summary
+    double time = std::chrono::duration<double>(Clock::now() - startTime).count();
+    size_t f = footprintCount.load();
+    size_t w = warningCount.load();
+    size_t e = errorCount.load();
+    std::ostringstream summary;
+    summary << "Generated " << f << " footprints in " << std::fixed << std::setprecision(2) << time << " s, " << w
+        << " warnings, " << e << " errors\n";
+    std::cerr << summary.str();
+    if (logFile.is_open()) {
+        nlohmann::json j;
+        j["time"] = time;
+        j["event"] = "summary";
+        j["footprints"] = f;
+        j["warnings"] = w;
+        j["errors"] = e;
+        logFile << j.dump() << '\n';
+        logFile.close();
+    }
+}
+
+void setReportTotal(size_t count) {
+    total.store(count, std::memory_order_relaxed);
+}
+
+void reportFootprint(std::string_view name) {
+    footprintCount.fetch_add(1, std::memory_order_relaxed);
+    push(EventType::FOOTPRINT, name, {});
+}
+
+void reportWarning(std::string_view footprint, std::string_view message) {
+    warningCount.fetch_add(1, std::memory_order_relaxed);
+    push(EventType::WARNING, footprint, message);
+}
+
+void reportError(std::string_view footprint, std::string_view message) {
+    errorCount.fetch_add(1, std::memory_order_relaxed);
+    if (errorCapture != nullptr) {
+        std::string error(footprint);
+        if (!error.empty())
+            error += ": ";
+        error += message;
+        errorCapture->errors.push_back(std::move(error));
+        return;
+    }
+    push(EventType::ERROR, footprint, message);
+}
+
+size_t getErrorCount() {
+    return errorCount.load();
+}
+
+
+ErrorCapture::ErrorCapture() : previous(errorCapture) {
+    errorCapture = this;
+}
+
+ErrorCapture::~ErrorCapture() {
+    errorCapture = this->previous;
+}
+
+std::string ErrorCapture::getMessage() const {
+    std::string message;
+    for (auto &error : this->errors) {
+        if (!message.empty())
+            message += '\n';
+        message += error;
+    }
+    return message;
+}
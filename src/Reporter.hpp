@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// progress and diagnostics of all threads. Reporting only pushes an event onto a lock-free list, a background thread
+// prints warnings and errors, a throttled progress line (if stderr is a terminal) and optionally writes all events
+// as json lines to a log file. If the reporter is not started, warnings and errors are printed directly
+
+// start the background thread, the log is written if a path is given. Returns false if the log can't be created
+bool startReporter(const fs::path &logPath = {});
+
+// print the remaining events and a summary and stop the background thread
+void stopReporter();
+
+// set the total number of footprints for the progress line if it is known
+void setReportTotal(size_t total);
+
+// a footprint was generated
+void reportFootprint(std::string_view name);
+
+// a warning or an error, footprint is the name of the footprint the message refers to or empty
+void reportWarning(std::string_view footprint, std::string_view message);
+void reportError(std::string_view footprint, std::string_view message);
+
+// number of errors that were reported
+size_t getErrorCount();
+
+// collects the errors that are reported on the current thread while it exists instead of printing them, e.g. to raise
+// them as python exceptions
+class ErrorCapture {
+public:
+    ErrorCapture();
+    ~ErrorCapture();
+    ErrorCapture(const ErrorCapture &) = delete;
+    ErrorCapture &operator =(const ErrorCapture &) = delete;
+
+    bool empty() const {return this->errors.empty();}
+
+    // all errors separated by newlines
+    std::string getMessage() const;
+
+protected:
+    ErrorCapture *previous;
+    std::vector<std::string> errors;
+
+    friend void reportError(std::string_view footprint, std::string_view message);
+};
@@ -0,0 +1,158 @@
+#include "Scheduler.hpp"
+#include <algorithm>
+#include <limits>
+
+
+namespace {
+
+// scheduler and index of the worker of the current thread or nullptr and -1
+thread_local Scheduler *currentScheduler = nullptr;
+thread_local int currentWorker = -1;
+
+bool lessCost(const Scheduler::Task &a, const Scheduler::Task &b) {
+    return a.cost < b.cost;
+}
+
+} // namespace
+
+
+Scheduler::Scheduler(int threadCount) {
+    threadCount = std::max(threadCount, 1);
+    for (int i = 0; i < threadCount; ++i)
+        this->queues.push_back(std::make_unique<Queue>());
+    for (int i = 0; i < threadCount; ++i)
+        this->threads.emplace_back(&Scheduler::run, this, i);
+}
+
+Scheduler::~Scheduler() {
+    finish();
+}
+
+void Scheduler::push(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        ++this->active;
+    }
+
+    // dependent tasks stay on the worker that created them, other tasks are distributed round robin
+    int worker = currentWorker >= 0 ? currentWorker : int(this->next++ % this->queues.size());
+    auto &queue = *this->queues[worker];
+    {
+        std::lock_guard<std::mutex> queueLock(queue.mutex);
+        queue.heap.push_back(std::move(task));
+        std::push_heap(queue.heap.begin(), queue.heap.end(), lessCost);
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        ++this->queued;
+    }
+    this->notEmpty.notify_one();
+}
+
+Scheduler *Scheduler::getCurrent() {
+    return currentScheduler;
+}
+
+void Scheduler::forEach(int count, const std::function<void (int index)> &function) {
+    // calls that are not yet started are taken by the subtasks and the calling thread, therefore the calling thread
+    // only waits for calls that are running
+    struct Group {
+        std::atomic<int> next = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+        int done = 0;
+    };
+    auto group = std::make_shared<Group>();
+    auto work = [group, count, &function] {
+        // a subtask that starts after the calling thread has returned finds no index and does not call the function
+        int index;
+        while ((index = group->next++) < count) {
+            function(index);
+            std::lock_guard<std::mutex> lock(group->mutex);
+            if (++group->done == count)
+                group->finished.notify_all();
+        }
+    };
+    for (int i = 1; i < count; ++i)
+        push({std::numeric_limits<double>::infinity(), [work](int worker) {work();}});
+    work();
+
+    std::unique_lock<std::mutex> lock(group->mutex);
+    group->finished.wait(lock, [&group, count] {return group->done == count;});
+}
+
+void Scheduler::waitBelow(size_t count) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->notFull.wait(lock, [this, count] {return this->active < count;});
+}
+
+void Scheduler::finish() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->done = true;
+    }
+    this->notEmpty.notify_all();
+    for (auto &thread : this->threads)
+        thread.join();
+    this->threads.clear();
+}
+
+bool Scheduler::pop(std::vector<Task> &heap, Task &task) {
+    if (heap.empty())
+        return false;
+    std::pop_heap(heap.begin(), heap.end(), lessCost);
+    task = std::move(heap.back());
+    heap.pop_back();
+    return true;
+}
+
+bool Scheduler::take(int worker, Task &task) {
+    // own queue first, then steal from the other workers
+    int count = this->queues.size();
+    for (int i = 0; i < count; ++i) {
+        auto &queue = *this->queues[(worker + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (pop(queue.heap, task))
+            return true;
+    }
+    return false;
+}
+
+void Scheduler::run(int worker) {
+    currentScheduler = this;
+    currentWorker = worker;
+    Task task;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        if (this->queued > 0) {
+            lock.unlock();
+            bool found = take(worker, task);
+            lock.lock();
+            if (!found) {
+                // another worker took the task but has not yet updated the count
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+                continue;
+            }
+            --this->queued;
+        } else if (this->done && this->active == 0) {
+            break;
+        } else {
+            this->notEmpty.wait(lock);
+            continue;
+        }
+        lock.unlock();
+
+        task.run(worker);
+        task.run = nullptr;
+
+        lock.lock();
+        --this->active;
+        this->notFull.notify_all();
+
+        // wake up others if all tasks are done
+        if (this->done && this->active == 0)
+            this->notEmpty.notify_all();
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// runs tasks on worker threads with work stealing. Each worker has its own queue ordered by expected cost so that
+// long tasks start first, an idle worker steals the most expensive task of another worker
+class Scheduler {
+public:
+    struct Task {
+        // expected cost in arbitrary units, tasks with higher cost are started first
+        double cost;
+
+        // function that runs the task, gets the index of the worker. It may push further tasks (dependent tasks)
+        std::function<void (int worker)> run;
+    };
+
+    explicit Scheduler(int threadCount);
+    ~Scheduler();
+
+    int getThreadCount() const {return int(this->threads.size());}
+
+    // scheduler of the current worker thread or nullptr if the current thread is not a worker
+    static Scheduler *getCurrent();
+
+    // add a task, a task that is pushed by a worker goes to the queue of the worker
+    void push(Task task);
+
+    // call a function for the indices 0 to count - 1 in parallel and wait until all calls are done. The calls run as
+    // tasks that start before all other tasks and on the calling thread, so a worker can wait for its own subtasks
+    void forEach(int count, const std::function<void (int index)> &function);
+
+    // block while more than the given number of tasks are queued or running, bounds the tasks of a reading thread
+    void waitBelow(size_t count);
+
+    // wait until all tasks are done and stop the workers
+    void finish();
+
+protected:
+    struct Queue {
+        std::mutex mutex;
+        std::vector<Task> heap;
+    };
+
+    static bool pop(std::vector<Task> &heap, Task &task);
+    bool take(int worker, Task &task);
+    void run(int worker);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+
+    // number of tasks in the worker queues, may be negative for a moment because it is updated after the queue
+    long queued = 0;
+
+    // number of tasks that are queued or running
+    size_t active = 0;
+
+    bool done = false;
+
+    // queue that gets the next task pushed by a thread that is not a worker
+    std::atomic<unsigned> next = 0;
+};
@@ -0,0 +1,215 @@
+#include "Shard.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+
+
+using json = nlohmann::json;
+
+
+bool Shard::parse(std::string_view s) {
+    auto slash = s.find('/');
+    if (slash == std::string_view::npos)
+        return false;
+    auto index = s.substr(0, slash);
+    auto count = s.substr(slash + 1);
+    if (std::from_chars(index.data(), index.data() + index.size(), this->index).ptr != index.data() + index.size()
+        || std::from_chars(count.data(), count.data() + count.size(), this->count).ptr != count.data() + count.size())
+    {
+        return false;
+    }
+    return this->count >= 1 && this->index >= 0 && this->index < this->count;
+}
+
+bool Shard::contains(std::string_view name, int variant) const {
+    if (this->count <= 1)
+        return true;
+
+    // FNV-1a of name and variant index
+    uint64_t hash = 0xcbf29ce484222325;
+    for (char c : name) {
+        hash ^= uint8_t(c);
+        hash *= 0x100000001b3;
+    }
+    if (variant >= 0) {
+        for (int i = 0; i < 4; ++i) {
+            hash ^= uint8_t(variant >> i * 8);
+            hash *= 0x100000001b3;
+        }
+    }
+
+    // fold high bits into low bits for a better distribution over small shard counts
+    hash ^= hash >> 32;
+    return int(hash % uint64_t(this->count)) == this->index;
+}
+
+fs::path Shard::getManifestPath(const fs::path &path) const {
+    fs::path manifestPath = path;
+    manifestPath.replace_extension(".shard-" + std::to_string(this->index) + "-of-" + std::to_string(this->count)
+        + ".manifest");
+    return manifestPath;
+}
+
+
+void ManifestOutput::write(fs::path path, std::string data) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->files.push_back(path.lexically_relative(this->dir).generic_string());
+    }
+    this->output->write(std::move(path), std::move(data));
+}
+
+void ManifestOutput::write(int sequence, fs::path path, std::string data) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->files.push_back(path.lexically_relative(this->dir).generic_string());
+    }
+    this->output->write(sequence, std::move(path), std::move(data));
+}
+
+void ManifestOutput::complete(int sequence) {
+    this->output->complete(sequence);
+}
+
+bool ManifestOutput::finish() {
+    return this->output->finish();
+}
+
+std::vector<std::string> ManifestOutput::getFiles() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto files = this->files;
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+
+static bool write(const fs::path &path, const json &j) {
+    std::ofstream s(path.string());
+    if (!s.is_open()) {
+        std::cerr << "error: could not write file " << path.string() << std::endl;
+        return false;
+    }
+    s << j.dump(4) << std::endl;
+    return true;
+}
+
+bool writeManifest(const fs::path &path, const Shard &shard, uint64_t sourceHash, std::vector<std::string> footprints,
+    std::vector<std::string> files, const fs::path &archive)
+{
+    std::sort(footprints.begin(), footprints.end());
+    std::sort(files.begin(), files.end());
+
+    json j;
+    j["shard"] = shard.index;
+    j["count"] = shard.count;
+    j["source"] = sourceHash;
+    j["footprints"] = std::move(footprints);
+    j["files"] = std::move(files);
+    if (archive == "-")
+        j["archive"] = "-";
+    else if (!archive.empty())
+        j["archive"] = archive.lexically_proximate(path.parent_path()).generic_string();
+    return write(path, j);
+}
+
+bool mergeManifests(const fs::path &path, const std::vector<fs::path> &manifests) {
+    int count = 0;
+    uint64_t sourceHash = 0;
+    std::vector<bool> present;
+    std::vector<std::string> footprints;
+    std::vector<std::string> files;
+    std::vector<std::string> archives;
+
+    // files that were written directly, entries of tar archives are not checked
+    std::vector<std::string> directFiles;
+    bool success = true;
+    for (auto &manifestPath : manifests) {
+        std::ifstream s(manifestPath.string());
+        if (!s.is_open()) {
+            std::cerr << "error: could not open file " << manifestPath.string() << std::endl;
+            return false;
+        }
+        try {
+            json j = json::parse(s);
+            int shard = j.at("shard").get<int>();
+            if (present.empty()) {
+                count = j.at("count").get<int>();
+                sourceHash = j.at("source").get<uint64_t>();
+                present.resize(count);
+            } else if (j.at("count").get<int>() != count) {
+                std::cerr << "error: " << manifestPath.string() << ": shard count differs" << std::endl;
+                return false;
+            } else if (j.at("source").get<uint64_t>() != sourceHash) {
+                std::cerr << "error: " << manifestPath.string() << ": generated from a different source" << std::endl;
+                return false;
+            }
+            if (shard < 0 || shard >= count || present[shard]) {
+                std::cerr << "error: " << manifestPath.string() << ": invalid or duplicate shard " << shard << std::endl;
+                return false;
+            }
+            present[shard] = true;
+            for (auto &footprint : j.at("footprints"))
+                footprints.push_back(footprint.get<std::string>());
+            bool archived = j.contains("archive");
+            if (archived)
+                archives.push_back(j["archive"].get<std::string>());
+            for (auto &file : j.at("files")) {
+                files.push_back(file.get<std::string>());
+                if (!archived)
+                    directFiles.push_back(files.back());
+            }
+        } catch (std::exception &e) {
+            std::cerr << "error: " << manifestPath.string() << ": " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    // check that all shards are present
+    for (int i = 0; i < count; ++i) {
+        if (!present[i]) {
+            std::cerr << "error: shard " << i << " of " << count << " is missing" << std::endl;
+            success = false;
+        }
+    }
+
+    // check that no footprint was generated twice
+    std::sort(footprints.begin(), footprints.end());
+    auto duplicateFootprint = std::adjacent_find(footprints.begin(), footprints.end());
+    if (duplicateFootprint != footprints.end()) {
+        std::cerr << "error: footprint " << *duplicateFootprint << " was generated by more than one shard" << std::endl;
+        success = false;
+    }
+    std::sort(files.begin(), files.end());
+    auto duplicate = std::adjacent_find(files.begin(), files.end());
+    if (duplicate != files.end()) {
+        std::cerr << "error: file " << *duplicate << " was generated by more than one shard" << std::endl;
+        success = false;
+    }
+
+    // the files and archives of all shards are expected next to the merged manifest
+    auto dir = path.parent_path();
+    for (auto &file : directFiles) {
+        if (!fs::exists(dir / file))
+            std::cerr << "warning: file " << file << " not found" << std::endl;
+    }
+    for (auto &archive : archives) {
+        if (archive != "-" && !fs::exists(dir / archive))
+            std::cerr << "warning: archive " << archive << " not found" << std::endl;
+    }
+
+    if (!success)
+        return false;
+
+    json j;
+    j["count"] = count;
+    j["source"] = sourceHash;
+    j["footprints"] = std::move(footprints);
+    j["files"] = std::move(files);
+    if (!archives.empty()) {
+        std::sort(archives.begin(), archives.end());
+        j["archives"] = std::move(archives);
+    }
+    return write(path, j);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Output.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+
+// deterministic subset of the footprints so that generation can be distributed across machines (--shard index/count)
+struct Shard {
+    int index = 0;
+    int count = 1;
+
+    // parse "index/count" where index is in the range 0 to count - 1, returns false if invalid
+    bool parse(std::string_view s);
+
+    // check if a footprint or a variant of a footprint family belongs to this shard, the assignment only depends on
+    // the name and the index of the variant
+    bool contains(std::string_view name, int variant = -1) const;
+
+    // path of the manifest of this shard, e.g. lib.shard-1-of-4.manifest for lib.json
+    fs::path getManifestPath(const fs::path &path) const;
+};
+
+// output that records the written files for the manifest
+class ManifestOutput : public Output {
+public:
+    ManifestOutput(std::unique_ptr<Output> output, const fs::path &dir) : output(std::move(output)), dir(dir) {}
+
+    void write(fs::path path, std::string data) override;
+    void write(int sequence, fs::path path, std::string data) override;
+    void complete(int sequence) override;
+    bool finish() override;
+
+    // get the written files relative to the directory, sorted by name
+    std::vector<std::string> getFiles();
+
+protected:
+    std::unique_ptr<Output> output;
+    fs::path dir;
+    std::mutex mutex;
+    std::vector<std::string> files;
+};
+
+// write the manifest of a shard which lists the generated footprints and files. If the files were written into a tar
+// archive, archive is the path of the archive ("-" for stdout) and the files are entries of the archive
+bool writeManifest(const fs::path &path, const Shard &shard, uint64_t sourceHash, std::vector<std::string> footprints,
+    std::vector<std::string> files, const fs::path &archive = {});
+
+// merge the manifests of all shards into one manifest. Fails if a shard is missing or the shards were generated from
+// different sources
+bool mergeManifests(const fs::path &path, const std::vector<fs::path> &manifests);
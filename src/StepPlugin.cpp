@@ -0,0 +1,88 @@
+#include "StepPlugin.hpp"
+#include "Reporter.hpp"
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+// file name of the plugin module, normally defined by the build
+#ifndef STEP_PLUGIN_NAME
+#ifdef _WIN32
+#define STEP_PLUGIN_NAME "footprint-step.dll"
+#else
+#define STEP_PLUGIN_NAME "libfootprint-step.so"
+#endif
+#endif
+
+using GetPlugin = const StepPlugin *(*)(int version);
+
+// directory of the executable or python module that contains this code, the plugin is searched there and in ../lib
+static fs::path moduleDirectory() {
+#if defined(_WIN32)
+    HMODULE module = nullptr;
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+        reinterpret_cast<LPCWSTR>(&moduleDirectory), &module);
+    wchar_t path[MAX_PATH];
+    DWORD length = GetModuleFileNameW(module, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH)
+        return {};
+    return fs::path(path).parent_path();
+#elif defined(__linux__)
+    // a shared module (python) is loaded with absolute path, for the executable dladdr only reports argv[0]
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void *>(&moduleDirectory), &info) != 0 && info.dli_fname != nullptr
+        && fs::path(info.dli_fname).is_absolute())
+    {
+        return fs::path(info.dli_fname).parent_path();
+    }
+    std::error_code ec;
+    return fs::read_symlink("/proc/self/exe", ec).parent_path();
+#else
+    return {};
+#endif
+}
+
+// load plugin module and look up the entry function
+static GetPlugin load(const fs::path &path) {
+#ifdef _WIN32
+    HMODULE module = LoadLibraryW(path.c_str());
+    if (module == nullptr)
+        return nullptr;
+    return reinterpret_cast<GetPlugin>(GetProcAddress(module, "footprintStepPlugin"));
+#else
+    void *module = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (module == nullptr)
+        return nullptr;
+    return reinterpret_cast<GetPlugin>(dlsym(module, "footprintStepPlugin"));
+#endif
+}
+
+const StepPlugin *getStepPlugin() {
+    static std::once_flag flag;
+    static const StepPlugin *plugin = nullptr;
+    std::call_once(flag, [] {
+        // search next to the executable or python module, in ../lib and in the default search path of the system
+        fs::path dir = moduleDirectory();
+        fs::path paths[] = {dir / STEP_PLUGIN_NAME, dir.parent_path() / "lib" / STEP_PLUGIN_NAME, STEP_PLUGIN_NAME};
+        for (auto &path : paths) {
+            if (path.has_parent_path() && !fs::exists(path))
+                continue;
+            GetPlugin getPlugin = load(path);
+            if (getPlugin != nullptr) {
+                plugin = getPlugin(STEP_PLUGIN_VERSION);
+                if (plugin != nullptr)
+                    return;
+            }
+        }
+        reportWarning({}, std::string("step plugin ") + STEP_PLUGIN_NAME + " not found, no step files are generated");
+    });
+    return plugin;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "double3.hpp"
+#include <ostream>
+#include <vector>
+
+
+// step export and tessellation of 3D models are a separate module so that OpenCASCADE is only loaded when needed
+constexpr int STEP_PLUGIN_VERSION = 2;
+
+// functions of the step plugin. The plugin exports footprintStepPlugin(version) which returns the functions or
+// nullptr if the version does not match
+struct StepPlugin {
+    // generate a box as step, see generateStep()
+    bool (*generateStep)(std::ostream &s, double3 center, double3 size);
+
+    // tessellate the body for vrml, see tessellateBody()
+    bool (*tessellateBody)(double3 size, double deflection, std::vector<double3> &points, std::vector<int> &triangles);
+};
+
+// load the step plugin on first use, returns nullptr if it is not available
+const StepPlugin *getStepPlugin();
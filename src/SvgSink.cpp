@@ -0,0 +1,128 @@
+#include "FootprintSink.hpp"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+
+// color of a layer in the preview
+static std::string_view layerColor(std::string_view layer) {
+    if (layer == "F.Cu")
+        return "#c83434";
+    if (layer == "B.Cu")
+        return "#4d7fc4";
+    if (layer == "F.SilkS")
+        return "#f2eda1";
+    if (layer == "F.Fab")
+        return "#afafaf";
+    if (layer == "F.CrtYd")
+        return "#ff26e2";
+    return "#848484";
+}
+
+// writes a preview of the footprint as svg (.svg), coordinates are in mm
+class SvgSink : public FootprintSink {
+public:
+    SvgSink(const fs::path &dir, Output &output) : dir(dir), output(output) {}
+
+    void begin(const std::string &name, const Footprint &footprint, bool haveBody) override {
+        this->name = name;
+        this->s.str({});
+        this->min = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+        this->max = {std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+    }
+
+    void pad(std::string_view name, double2 position, double2 size, double2 offset, double shape,
+        double2 drillSize, const Footprint::Pad &pad) override
+    {
+        bool hasDrill = drillSize.positive();
+
+        // pad
+        if (size.positive()) {
+            double radius = std::min(size.x, size.y) * std::clamp(shape, 0.0, 0.5);
+            writeRect(position + offset, size, radius, layerColor(hasDrill || !pad.back ? "F.Cu" : "B.Cu"));
+        }
+
+        // drill
+        if (hasDrill)
+            writeRect(position, drillSize, std::min(drillSize.x, drillSize.y) * 0.5, "#000000");
+    }
+
+    void line(double2 p1, double2 p2, double width, std::string_view layer) override {
+        writeLine(p1, p2, width, layer);
+    }
+
+    void line(double2 position, const Footprint::Line &line) override {
+        int segmentCount = line.points.size() - 1;
+        for (int i = 0; i < segmentCount; ++i)
+            writeLine(position + line.points[i], position + line.points[i + 1], line.width, line.layer);
+    }
+
+    void circle(double2 position, const Footprint::Circle &circle) override {
+        double2 center = position + circle.center;
+        double r = circle.radius + circle.width * 0.5;
+        extend(center - double2(r, r));
+        extend(center + double2(r, r));
+        auto color = layerColor(circle.layer);
+        this->s << "<circle cx=\"" << center.x << "\" cy=\"" << center.y << "\" r=\"" << circle.radius << "\"";
+        if (circle.fill)
+            this->s << " fill=\"" << color << "\"";
+        else
+            this->s << " fill=\"none\"";
+        if (circle.width > 0)
+            this->s << " stroke=\"" << color << "\" stroke-width=\"" << circle.width << "\"";
+        this->s << "/>\n";
+    }
+
+    void end() override {
+        if (this->min.x > this->max.x)
+            this->min = this->max = {0, 0};
+
+        // add margin
+        double2 p = this->min - double2(1, 1);
+        double2 size = this->max - this->min + double2(2, 2);
+
+        std::ostringstream s;
+        s << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << size.x << "mm\" height=\"" << size.y << "mm\""
+            " viewBox=\"" << p.x << ' ' << p.y << ' ' << size.x << ' ' << size.y << "\">\n";
+        s << "<rect x=\"" << p.x << "\" y=\"" << p.y << "\" width=\"" << size.x << "\" height=\"" << size.y << "\""
+            " fill=\"#001023\"/>\n";
+        s << this->s.str();
+        s << "</svg>\n";
+        this->output.write(this->dir / (this->name + ".svg"), std::move(s).str());
+    }
+
+protected:
+    void extend(double2 p) {
+        this->min = {std::min(this->min.x, p.x), std::min(this->min.y, p.y)};
+        this->max = {std::max(this->max.x, p.x), std::max(this->max.y, p.y)};
+    }
+
+    void writeRect(double2 center, double2 size, double radius, std::string_view color) {
+        double2 p = center - size * 0.5;
+        extend(p);
+        extend(p + size);
+        this->s << "<rect x=\"" << p.x << "\" y=\"" << p.y << "\" width=\"" << size.x << "\" height=\"" << size.y << "\"";
+        if (radius > 0)
+            this->s << " rx=\"" << radius << "\"";
+        this->s << " fill=\"" << color << "\"/>\n";
+    }
+
+    void writeLine(double2 p1, double2 p2, double width, std::string_view layer) {
+        double w = width * 0.5;
+        extend({std::min(p1.x, p2.x) - w, std::min(p1.y, p2.y) - w});
+        extend({std::max(p1.x, p2.x) + w, std::max(p1.y, p2.y) + w});
+        this->s << "<line x1=\"" << p1.x << "\" y1=\"" << p1.y << "\" x2=\"" << p2.x << "\" y2=\"" << p2.y << "\""
+            " stroke=\"" << layerColor(layer) << "\" stroke-width=\"" << width << "\" stroke-linecap=\"round\"/>\n";
+    }
+
+    fs::path dir;
+    Output &output;
+    std::string name;
+    std::ostringstream s;
+    double2 min;
+    double2 max;
+};
+
+std::unique_ptr<FootprintSink> createSvgSink(const fs::path &dir, Output &output) {
+    return std::make_unique<SvgSink>(dir, output);
+}
@@ -0,0 +1,126 @@
+#include "FootprintSink.hpp"
+#include <sstream>
+
+
+// escape a string for use in an xml attribute
+static std::string escape(std::string_view str) {
+    std::string result;
+    for (char c : str) {
+        switch (c) {
+        case '&':
+            result += "&amp;";
+            break;
+        case '<':
+            result += "&lt;";
+            break;
+        case '>':
+            result += "&gt;";
+            break;
+        case '"':
+            result += "&quot;";
+            break;
+        default:
+            result += c;
+        }
+    }
+    return result;
+}
+
+// name of pad shape
+static std::string_view shapeName(double shape, double2 size) {
+    if (shape <= RECTANGLE)
+        return "rectangle";
+    if (shape >= CIRCLE)
+        return size.x == size.y ? "round" : "oblong";
+    return "roundedRectangle";
+}
+
+// writes the land pattern in IPC-7351 style as xml (.xml), coordinates are in mm
+class XmlSink : public FootprintSink {
+public:
+    XmlSink(const fs::path &dir, Output &output) : dir(dir), output(output) {}
+
+    void begin(const std::string &name, const Footprint &footprint, bool haveBody) override {
+        this->name = name;
+        this->s.str({});
+        auto &s = this->s;
+        s << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+        s << "<LandPattern name=\"" << escape(name) << "\" description=\"" << escape(footprint.description) << "\"";
+        s << " mount=\"" << (footprint.getType() == Footprint::Type::THROUGH_HOLE ? "throughHole" : "smd") << "\"";
+        s << " units=\"mm\">\n";
+    }
+
+    void body(double3 center, double3 size) override {
+        this->s << "  <Body x=\"" << center.x << "\" y=\"" << -center.y << "\" z=\"" << center.z << "\""
+            " width=\"" << size.x << "\" length=\"" << size.y << "\" height=\"" << size.z << "\"/>\n";
+    }
+
+    void pad(std::string_view name, double2 position, double2 size, double2 offset, double shape,
+        double2 drillSize, const Footprint::Pad &pad) override
+    {
+        bool hasPad = size.positive();
+        bool hasDrill = drillSize.positive();
+        auto &s = this->s;
+        s << "  <Pad number=\"" << escape(name) << "\" x=\"" << position.x << "\" y=\"" << position.y << "\"";
+        if (hasPad) {
+            s << " width=\"" << size.x << "\" length=\"" << size.y << "\" shape=\"" << shapeName(shape, size) << "\"";
+            if (shape > RECTANGLE && shape < CIRCLE)
+                s << " cornerRatio=\"" << shape << "\"";
+            if (!offset.zero())
+                s << " offsetX=\"" << offset.x << "\" offsetY=\"" << offset.y << "\"";
+        }
+        if (hasDrill) {
+            s << " drillWidth=\"" << drillSize.x << "\" drillLength=\"" << drillSize.y << "\"";
+            s << " plated=\"" << (hasPad ? "true" : "false") << "\"";
+        }
+        s << " side=\"" << (hasDrill ? "both" : pad.back ? "bottom" : "top") << "\"";
+        if (pad.clearance > 0)
+            s << " clearance=\"" << pad.clearance << "\"";
+        if (pad.maskMargin != 0)
+            s << " maskMargin=\"" << pad.maskMargin << "\"";
+        if (!pad.mask)
+            s << " mask=\"false\"";
+        if (!pad.paste)
+            s << " paste=\"false\"";
+        s << "/>\n";
+    }
+
+    void line(double2 p1, double2 p2, double width, std::string_view layer) override {
+        writeLine(p1, p2, width, layer);
+    }
+
+    void line(double2 position, const Footprint::Line &line) override {
+        int segmentCount = line.points.size() - 1;
+        for (int i = 0; i < segmentCount; ++i)
+            writeLine(position + line.points[i], position + line.points[i + 1], line.width, line.layer);
+    }
+
+    void circle(double2 position, const Footprint::Circle &circle) override {
+        double2 center = position + circle.center;
+        this->s << "  <Circle layer=\"" << escape(circle.layer) << "\" x=\"" << center.x << "\" y=\"" << center.y
+            << "\" radius=\"" << circle.radius << "\" width=\"" << circle.width << "\"";
+        if (circle.fill)
+            this->s << " fill=\"true\"";
+        this->s << "/>\n";
+    }
+
+    void end() override {
+        this->s << "</LandPattern>\n";
+        this->output.write(this->dir / (this->name + ".xml"), std::move(this->s).str());
+    }
+
+protected:
+    void writeLine(double2 p1, double2 p2, double width, std::string_view layer) {
+        this->s << "  <Line layer=\"" << escape(layer) << "\" x1=\"" << p1.x << "\" y1=\"" << p1.y << "\" x2=\""
+            << p2.x << "\" y2=\"" << p2.y << "\" width=\"" << width << "\"/>\n";
+    }
+
+    fs::path dir;
+    Output &output;
+    std::string name;
+    std::ostringstream s;
+};
+
+std::unique_ptr<FootprintSink> createXmlSink(const fs::path &dir, Output &output) {
+    return std::make_unique<XmlSink>(dir, output);
+}
@@ -7,8 +7,8 @@ struct double2 {
 	double x;
 	double y;
 
-	double2() : x(), y() {}
-	double2(double x, double y) : x(x), y(y) {}
+	constexpr double2() : x(), y() {}
+	constexpr double2(double x, double y) : x(x), y(y) {}
 
 	bool positive() const {return x > 0 && y > 0;}
 	bool zero() const {return x == 0 && y == 0;}
@@ -8,8 +8,8 @@ struct double3 {
 	double y;
 	double z;
 
-	double3() : x(), y(), z() {}
-	double3(double x, double y, double z) : x(x), y(y), z(z) {}
+	constexpr double3() : x(), y(), z() {}
+	constexpr double3(double x, double y, double z) : x(x), y(y), z(z) {}
 	double2 xy() const {return {x, y};}
 };
 
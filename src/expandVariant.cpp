@@ -0,0 +1,73 @@
+#include "expandVariant.hpp"
+#include "readJson.hpp"
+#include "solveLandPatterns.hpp"
+#include <sstream>
+
+
+namespace {
+
+// replace all occurrences of a placeholder in a string
+void replace(std::string &s, const std::string &placeholder, const std::string &value) {
+    size_t pos = 0;
+    while ((pos = s.find(placeholder, pos)) != std::string::npos) {
+        s.replace(pos, placeholder.size(), value);
+        pos += value.size();
+    }
+}
+
+std::string toString(double value) {
+    std::ostringstream s;
+    s << value;
+    return s.str();
+}
+
+} // namespace
+
+
+void expandVariant(const std::string &pattern, const Footprint &family, int index, std::string &name,
+    Footprint &footprint)
+{
+    auto &variants = family.variants;
+
+    // split index into parameter indices, count varies fastest
+    int countIndex = index % std::max(int(variants.counts.size()), 1);
+    index /= std::max(int(variants.counts.size()), 1);
+    int rowsIndex = index % std::max(int(variants.rows.size()), 1);
+    index /= std::max(int(variants.rows.size()), 1);
+    int pitchIndex = index;
+
+    footprint = family;
+    footprint.variants = {};
+    auto &pad = footprint.pads[variants.pad];
+
+    // number of rows, a single or dual array is selected if given, otherwise it follows from the type of the array
+    int rows;
+    if (!variants.rows.empty()) {
+        rows = variants.rows[rowsIndex];
+        pad.type = rows == 1 ? Footprint::Pad::Type::SINGLE : Footprint::Pad::Type::DUAL;
+    } else {
+        rows = pad.getRowCount();
+    }
+
+    // number of pads per row
+    int count = variants.counts.empty() ? pad.count / rows : variants.counts[countIndex];
+    pad.count = count * rows;
+
+    // pitch
+    if (!variants.pitches.empty())
+        pad.pitch = variants.pitches[pitchIndex];
+
+    // evaluate expressions with the parameters of the variant, unknown parameters were reported when reading
+    std::string error;
+    evaluateBindings(footprint, error);
+
+    // the land pattern depends on the pitch and on dimensions that may be expressions
+    solveLandPatterns(footprint);
+
+    // name
+    name = pattern;
+    replace(name, "{count}", std::to_string(count));
+    replace(name, "{rows}", std::to_string(rows));
+    replace(name, "{pins}", std::to_string(pad.count));
+    replace(name, "{pitch}", toString(pad.pitch));
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Footprint.hpp"
+#include <string>
+
+
+// expand a variant of a footprint family. The name pattern is the name of the family in which {count}, {rows},
+// {pins} and {pitch} get replaced by the parameters of the variant. The index is in the range
+// 0 to family.variants.size() - 1
+void expandVariant(const std::string &pattern, const Footprint &family, int index, std::string &name,
+    Footprint &footprint);
@@ -1,36 +1,30 @@
 #include "generateStep.hpp"
-#include <BRepPrimAPI_MakeBox.hxx>
+#include "makeBody.hpp"
+#include "StepPlugin.hpp"
+#include "tessellateBody.hpp"
+#include <STEPControl_Controller.hxx>
 #include <STEPControl_Writer.hxx>
 #include <XSControl_WorkSession.hxx>
-#include <TopoDS_Solid.hxx>
 #include <IFSelect_ReturnStatus.hxx>
-#include <gp_Pnt.hxx>
 #include <Standard.hxx>
 #include <Interface_Static.hxx>
+#include <mutex>
 
 
-// generate a box as vrml as minimalistic 3D visualization
-bool generateStep(const fs::path &path, const std::string &name, const Footprint &footprint) {
-    // center of box
-    double3 center = footprint.body.offset + double3(footprint.position.x, footprint.position.y, 0);
-    center.y = -center.y;
+// the step translator shares global state (controller, protocol and work session statics), therefore only the body
+// is built in parallel and the transfer and writing of the step file are serialized
+static std::mutex stepMutex;
 
-    // size of box
-    double3 size = footprint.body.size;
 
+// generate a box as step as minimalistic 3D visualization
+bool generateStep(std::ostream &s, double3 center, double3 size) {
+    TopoDS_Shape box = makeBody(center, size);
+
+    // the global parameters are only set once when the plugin is loaded
+    std::lock_guard<std::mutex> lock(stepMutex);
     STEPControl_Writer writer;
     writer.WS()->TransferWriter()->FinderProcess()->Messenger()->ChangePrinters().Clear();
 
-    gp_Pnt p1(center.x - size.x * 0.5, center.y - size.y * 0.5, center.z);
-    gp_Pnt p2(center.x + size.x * 0.5, center.y + size.y * 0.5, center.z + size.z);
-
-    // create quader
-    BRepPrimAPI_MakeBox boxMaker(p1, p2);//size.x, size.y, size.z);
-    TopoDS_Solid box = boxMaker.Solid();  // Oder boxMaker.Shape() für TopoDS_Shape
-
-    // set unit to mm
-    Interface_Static::SetCVal("write.step.unit", "MM");
-
     // add shape to step model
     IFSelect_ReturnStatus status = writer.Transfer(box, STEPControl_AsIs);
     if (status != IFSelect_RetDone) {
@@ -39,10 +33,31 @@ bool generateStep(const fs::path &path, const std::string &name, const Footprint
     }
 
     // write step file
-    status = writer.Write((path / (name + ".step")).string().c_str());
+    status = writer.WriteStream(s);
     if (status != IFSelect_RetDone) {
         std::cerr << "Error: Writing step file failed!" << std::endl;
         return false;
     }
     return true;
 }
+
+
+// entry point of the step plugin
+#ifdef _WIN32
+#define STEP_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define STEP_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+extern "C" STEP_PLUGIN_EXPORT const StepPlugin *footprintStepPlugin(int version) {
+    if (version != STEP_PLUGIN_VERSION)
+        return nullptr;
+
+    // global parameters of the step translator are set before any step file is written, the plugin is loaded once
+    static const StepPlugin plugin = [] {
+        STEPControl_Controller::Init();
+        Interface_Static::SetCVal("write.step.unit", "MM");
+        return StepPlugin{generateStep, tessellateBody};
+    }();
+    return &plugin;
+}
@@ -1,12 +1,8 @@
 #pragma once
 
-#include "Footprint.hpp"
-#include <filesystem>
-#include <string>
+#include "double3.hpp"
+#include <ostream>
 
 
-namespace fs = std::filesystem;
-
-
-// generate a box as step as minimalistic 3D visualization
-bool generateStep(const fs::path &path, const std::string &name, const Footprint &footprint);
+// generate a box as step as minimalistic 3D visualization, center is at the bottom of the box in 3D coordinates (y up)
+bool generateStep(std::ostream &s, double3 center, double3 size);
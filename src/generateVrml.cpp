@@ -1,19 +1,7 @@
 #include "generateVrml.hpp"
-#include <fstream>
 
 
-// generate a box as vrml as minimalistic 3D visualization
-void generateVrml(const fs::path &path, const std::string &name, const Footprint &footprint) {
-    // center of box
-    double3 center = footprint.body.offset + double3(footprint.position.x, footprint.position.y, 0);
-    center.y = -center.y;
-
-    // size of box
-    double3 size = footprint.body.size;
-
-    // create output file
-    std::ofstream s((path / (name + ".wrl")).string());
-
+void writeVrml(std::ostream &s, double3 offset, const std::vector<double3> &points, const std::vector<int> &triangles) {
     // header
     s << R"vrml(#VRML V2.0 utf8
 Shape {
@@ -30,14 +18,24 @@ Shape {
 Shape {
     geometry IndexedFaceSet {
         creaseAngle 0.50
-        coordIndex [3,0,2,-1,3,1,0,-1,6,5,7,-1,6,4,5,-1,1,4,0,-1,1,5,4,-1,7,2,6,-1,7,3,2,-1,2,4,6,-1,2,0,4,-1,7,1,3,-1,7,5,1]
+        coordIndex [)vrml";
+
+    int triangleCount = triangles.size() / 3;
+    for (int i = 0; i < triangleCount; ++i) {
+        if (i != 0)
+            s << ",-1,";
+        s << triangles[i * 3] << ',' << triangles[i * 3 + 1] << ',' << triangles[i * 3 + 2];
+    }
+
+    s << R"vrml(]
         coord Coordinate {point [)vrml";
 
-    for (int i = 0; i < 8; ++i) {
+    // vrml units are 0.1 inch
+    int pointCount = points.size();
+    for (int i = 0; i < pointCount; ++i) {
         if (i != 0)
             s << ',';
-        double3 p = (center + size * double3(i & 1 ? 0.5 : -0.5, i & 2 ? 0.5 : -0.5, i & 4 ? 1.0 : 0.0)) / 2.54;
-        s << p;
+        s << (offset + points[i]) / 2.54;
     }
 
 s << R"vrml(]}
@@ -45,6 +43,16 @@ s << R"vrml(]}
     appearance Appearance {material USE mat}
 }
 )vrml";
+}
+
+// generate a box as vrml as minimalistic 3D visualization
+void generateVrml(std::ostream &s, double3 center, double3 size) {
+    static const std::vector<int> triangles = {3,0,2, 3,1,0, 6,5,7, 6,4,5, 1,4,0, 1,5,4, 7,2,6, 7,3,2, 2,4,6, 2,0,4,
+        7,1,3, 7,5,1};
+
+    std::vector<double3> points;
+    for (int i = 0; i < 8; ++i)
+        points.push_back(size * double3(i & 1 ? 0.5 : -0.5, i & 2 ? 0.5 : -0.5, i & 4 ? 1.0 : 0.0));
 
-    s.close();
+    writeVrml(s, center, points, triangles);
 }
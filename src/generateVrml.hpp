@@ -1,12 +1,12 @@
 #pragma once
 
-#include "Footprint.hpp"
-#include <filesystem>
-#include <string>
+#include "double3.hpp"
+#include <ostream>
+#include <vector>
 
 
-namespace fs = std::filesystem;
+// write a triangle mesh as vrml, the points are relative to offset, three indices into the points form a triangle
+void writeVrml(std::ostream &s, double3 offset, const std::vector<double3> &points, const std::vector<int> &triangles);
 
-
-// generate a box as vrml as minimalistic 3D visualization
-void generateVrml(const fs::path &path, const std::string &name, const Footprint &footprint);
+// generate a box as vrml as minimalistic 3D visualization, center is at the bottom of the box in 3D coordinates (y up). Used when the step plugin is not available
+void generateVrml(std::ostream &s, double3 center, double3 size);
@@ -0,0 +1,733 @@
+#include "importKicad.hpp"
+#include "MappedFile.hpp"
+#include "Reporter.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <string_view>
+
+
+namespace {
+
+// tokenizer for s-expressions, tokens are views into the source text (no allocation per token)
+class SExpr {
+public:
+    enum class Token {
+        OPEN,
+        CLOSE,
+        ATOM,
+        END
+    };
+
+    explicit SExpr(std::string_view text) : it(text.data()), end(text.data() + text.size()) {}
+
+    // get next token, the atom is stored in this->atom
+    Token next() {
+        while (this->it < this->end && (*this->it == ' ' || *this->it == '\t' || *this->it == '\r' || *this->it == '\n'))
+            ++this->it;
+        if (this->it >= this->end)
+            return Token::END;
+
+        char c = *this->it;
+        if (c == '(') {
+            ++this->it;
+            return Token::OPEN;
+        }
+        if (c == ')') {
+            ++this->it;
+            return Token::CLOSE;
+        }
+        if (c == '"') {
+            // quoted string, escape sequences are kept as they are
+            const char *begin = ++this->it;
+            while (this->it < this->end && *this->it != '"') {
+                if (*this->it == '\\' && this->it + 1 < this->end)
+                    ++this->it;
+                ++this->it;
+            }
+            this->atom = std::string_view(begin, this->it - begin);
+            if (this->it < this->end)
+                ++this->it;
+            return Token::ATOM;
+        }
+
+        // plain atom
+        const char *begin = this->it;
+        while (this->it < this->end) {
+            c = *this->it;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '(' || c == ')' || c == '"')
+                break;
+            ++this->it;
+        }
+        this->atom = std::string_view(begin, this->it - begin);
+        return Token::ATOM;
+    }
+
+    // skip the rest of the current list (opening parenthesis is already consumed)
+    void skipList() {
+        int depth = 1;
+        while (depth > 0) {
+            Token t = next();
+            if (t == Token::OPEN)
+                ++depth;
+            else if (t == Token::CLOSE)
+                --depth;
+            else if (t == Token::END)
+                return;
+        }
+    }
+
+    // read the keyword of a list (opening parenthesis is already consumed)
+    std::string_view keyword() {
+        if (next() == Token::ATOM)
+            return this->atom;
+        return {};
+    }
+
+    // read numbers of the current list and skip the rest, returns number of read values
+    int numbers(double *values, int count) {
+        int i = 0;
+        while (true) {
+            Token t = next();
+            if (t == Token::CLOSE || t == Token::END)
+                return i;
+            if (t == Token::OPEN) {
+                skipList();
+            } else if (i < count && toNumber(this->atom, values[i])) {
+                ++i;
+            }
+        }
+    }
+
+    // read a single atom of the current list and skip the rest
+    std::string_view value() {
+        std::string_view result;
+        while (true) {
+            Token t = next();
+            if (t == Token::CLOSE || t == Token::END)
+                return result;
+            if (t == Token::OPEN)
+                skipList();
+            else if (result.empty())
+                result = this->atom;
+        }
+    }
+
+    static bool toNumber(std::string_view s, double &value) {
+        auto r = std::from_chars(s.data(), s.data() + s.size(), value);
+        return r.ec == std::errc() && r.ptr == s.data() + s.size();
+    }
+
+    static bool toNumber(std::string_view s, int &value) {
+        auto r = std::from_chars(s.data(), s.data() + s.size(), value);
+        return r.ec == std::errc() && r.ptr == s.data() + s.size();
+    }
+
+    std::string_view atom;
+
+protected:
+    const char *it;
+    const char *end;
+};
+
+using Token = SExpr::Token;
+
+
+// pad as found in the .kicad_mod file
+struct ImportedPad {
+    std::string_view name;
+    bool hole = false;
+    double2 position;
+    double2 size;
+    double2 offset;
+    double shape = RECTANGLE;
+    double2 drillSize;
+    double clearance = 0;
+    double maskMargin = 0;
+    bool back = false;
+    bool mask = false;
+    bool paste = false;
+
+    // check if two pads can be part of the same pad array (offset is checked by the array detection)
+    bool sameKind(const ImportedPad &p) const {
+        return this->hole == p.hole
+            && this->size.x == p.size.x && this->size.y == p.size.y
+            && this->shape == p.shape
+            && this->drillSize.x == p.drillSize.x && this->drillSize.y == p.drillSize.y
+            && this->clearance == p.clearance && this->maskMargin == p.maskMargin
+            && this->back == p.back && this->mask == p.mask && this->paste == p.paste;
+    }
+};
+
+// line segment as found in the .kicad_mod file
+struct ImportedLine {
+    std::string_view layer;
+    double width = 0.1;
+    double2 start;
+    double2 end;
+};
+
+
+// read stroke width from (width w) or (stroke (width w) ...)
+double readWidth(SExpr &p, std::string_view keyword, double width) {
+    if (keyword == "width") {
+        p.numbers(&width, 1);
+    } else {
+        // stroke
+        while (true) {
+            Token t = p.next();
+            if (t == Token::CLOSE || t == Token::END)
+                break;
+            if (t == Token::OPEN) {
+                if (p.keyword() == "width")
+                    p.numbers(&width, 1);
+                else
+                    p.skipList();
+            }
+        }
+    }
+    return width;
+}
+
+void readPad(SExpr &p, ImportedPad &pad) {
+    // name, type and shape
+    if (p.next() != Token::ATOM)
+        return;
+    pad.name = p.atom;
+    if (p.next() != Token::ATOM)
+        return;
+    pad.hole = p.atom == "np_thru_hole";
+    if (p.next() != Token::ATOM)
+        return;
+    std::string_view shape = p.atom;
+    if (shape == "circle" || shape == "oval")
+        pad.shape = CIRCLE;
+    else if (shape == "roundrect")
+        pad.shape = ROUNDRECT;
+    else
+        pad.shape = RECTANGLE;
+
+    double rotation = 0;
+    while (true) {
+        Token t = p.next();
+        if (t == Token::CLOSE || t == Token::END)
+            break;
+        if (t != Token::OPEN)
+            continue;
+
+        std::string_view keyword = p.keyword();
+        if (keyword == "at") {
+            double v[3] = {0, 0, 0};
+            p.numbers(v, 3);
+            pad.position = {v[0], v[1]};
+            rotation = v[2];
+        } else if (keyword == "size") {
+            double v[2] = {0, 0};
+            p.numbers(v, 2);
+            pad.size = {v[0], v[1]};
+        } else if (keyword == "drill") {
+            // (drill d) or (drill oval w h), optionally followed by (offset x y)
+            double v[2] = {0, 0};
+            int i = 0;
+            while (true) {
+                t = p.next();
+                if (t == Token::CLOSE || t == Token::END)
+                    break;
+                if (t == Token::OPEN) {
+                    if (p.keyword() == "offset") {
+                        double o[2] = {0, 0};
+                        p.numbers(o, 2);
+                        pad.offset = {o[0], o[1]};
+                    } else {
+                        p.skipList();
+                    }
+                } else if (i < 2 && SExpr::toNumber(p.atom, v[i])) {
+                    ++i;
+                }
+            }
+            pad.drillSize = {v[0], i >= 2 ? v[1] : v[0]};
+        } else if (keyword == "layers") {
+            while ((t = p.next()) != Token::CLOSE && t != Token::END) {
+                if (t == Token::OPEN) {
+                    p.skipList();
+                    continue;
+                }
+                std::string_view layer = p.atom;
+                if (layer == "B.Cu")
+                    pad.back = true;
+                else if (layer.ends_with(".Mask"))
+                    pad.mask = true;
+                else if (layer.ends_with(".Paste"))
+                    pad.paste = true;
+            }
+        } else if (keyword == "roundrect_rratio") {
+            if (pad.shape != RECTANGLE && pad.shape != CIRCLE)
+                p.numbers(&pad.shape, 1);
+            else
+                p.skipList();
+        } else if (keyword == "clearance") {
+            p.numbers(&pad.clearance, 1);
+        } else if (keyword == "solder_mask_margin") {
+            p.numbers(&pad.maskMargin, 1);
+        } else {
+            p.skipList();
+        }
+    }
+
+    // size of pad is given in rotated coordinates
+    if (std::abs(std::fmod(std::abs(rotation), 180.0) - 90.0) < 1e-6)
+        pad.size = {pad.size.y, pad.size.x};
+
+    // drilled pads have no paste layer, reset paste to the default so that the writer does not emit "paste": false
+    if (pad.drillSize.positive())
+        pad.paste = true;
+
+    // non-plated hole: the generator derives the size from the drill size
+    if (pad.hole) {
+        pad.size = {};
+        pad.shape = ROUNDRECT;
+        pad.mask = true;
+        pad.paste = true;
+    }
+}
+
+void readLine(SExpr &p, ImportedLine &line) {
+    while (true) {
+        Token t = p.next();
+        if (t == Token::CLOSE || t == Token::END)
+            break;
+        if (t != Token::OPEN)
+            continue;
+
+        std::string_view keyword = p.keyword();
+        double v[2] = {0, 0};
+        if (keyword == "start") {
+            p.numbers(v, 2);
+            line.start = {v[0], v[1]};
+        } else if (keyword == "end") {
+            p.numbers(v, 2);
+            line.end = {v[0], v[1]};
+        } else if (keyword == "width" || keyword == "stroke") {
+            line.width = readWidth(p, keyword, line.width);
+        } else if (keyword == "layer") {
+            line.layer = p.value();
+        } else {
+            p.skipList();
+        }
+    }
+}
+
+// read rectangle outline as four line segments
+void readRectangle(SExpr &p, std::vector<ImportedLine> &lines) {
+    ImportedLine rect;
+    readLine(p, rect);
+    double2 corners[] = {rect.start, {rect.end.x, rect.start.y}, rect.end, {rect.start.x, rect.end.y}};
+    for (int i = 0; i < 4; ++i)
+        lines.push_back({rect.layer, rect.width, corners[i], corners[(i + 1) % 4]});
+}
+
+// read polygon outline as closed sequence of line segments
+void readPolygon(SExpr &p, std::vector<ImportedLine> &lines) {
+    std::vector<double2> points;
+    ImportedLine line;
+    while (true) {
+        Token t = p.next();
+        if (t == Token::CLOSE || t == Token::END)
+            break;
+        if (t != Token::OPEN)
+            continue;
+
+        std::string_view keyword = p.keyword();
+        if (keyword == "pts") {
+            // (pts (xy x y) ...)
+            while (true) {
+                t = p.next();
+                if (t == Token::CLOSE || t == Token::END)
+                    break;
+                if (t != Token::OPEN)
+                    continue;
+                double v[2] = {0, 0};
+                if (p.keyword() == "xy") {
+                    p.numbers(v, 2);
+                    points.push_back({v[0], v[1]});
+                } else {
+                    p.skipList();
+                }
+            }
+        } else if (keyword == "width" || keyword == "stroke") {
+            line.width = readWidth(p, keyword, line.width);
+        } else if (keyword == "layer") {
+            line.layer = p.value();
+        } else {
+            p.skipList();
+        }
+    }
+    int count = points.size();
+    if (count < 2)
+        return;
+    for (int i = 0; i < count; ++i) {
+        line.start = points[i];
+        line.end = points[(i + 1) % count];
+        lines.push_back(line);
+    }
+}
+
+void readCircle(SExpr &p, Footprint::Circle &circle) {
+    double2 end;
+    while (true) {
+        Token t = p.next();
+        if (t == Token::CLOSE || t == Token::END)
+            break;
+        if (t != Token::OPEN)
+            continue;
+
+        std::string_view keyword = p.keyword();
+        double v[2] = {0, 0};
+        if (keyword == "center") {
+            p.numbers(v, 2);
+            circle.center = {v[0], v[1]};
+        } else if (keyword == "end") {
+            p.numbers(v, 2);
+            end = {v[0], v[1]};
+        } else if (keyword == "width" || keyword == "stroke") {
+            circle.width = readWidth(p, keyword, circle.width);
+        } else if (keyword == "fill") {
+            auto fill = p.value();
+            circle.fill = fill == "solid" || fill == "yes";
+        } else if (keyword == "layer") {
+            circle.layer = p.value();
+        } else {
+            p.skipList();
+        }
+    }
+    double2 d = end - circle.center;
+    circle.radius = std::sqrt(d.x * d.x + d.y * d.y);
+}
+
+
+// round to get rid of floating point noise from differences of positions
+double snap(double v) {
+    return std::round(v * 1e6) / 1e6 + 0.0;
+}
+
+double2 snap(double2 v) {
+    return {snap(v.x), snap(v.y)};
+}
+
+bool equal(double a, double b) {
+    return std::abs(a - b) < 1e-4;
+}
+
+bool equal(double2 a, double2 b) {
+    return equal(a.x, b.x) && equal(a.y, b.y);
+}
+
+// transform from pad array coordinates to footprint coordinates (same as orient() of the generator)
+double2 orient(double2 p, Footprint::Orientation o) {
+    return o == Footprint::Orientation::TOP_LEFT ? double2(-p.y, p.x) : p;
+}
+
+// transform from footprint coordinates to pad array coordinates
+double2 unorient(double2 p, Footprint::Orientation o) {
+    return o == Footprint::Orientation::TOP_LEFT ? double2(p.y, -p.x) : p;
+}
+
+// check if count points starting at begin with given stride are on a row parallel to x with constant step
+bool isRow(const std::vector<double2> &points, int begin, int count, int stride, double &y, double &step) {
+    y = points[begin].y;
+    step = count >= 2 ? points[begin + stride].x - points[begin].x : 0;
+    for (int i = 0; i < count; ++i) {
+        double2 p = points[begin + i * stride];
+        if (!equal(p.y, y) || !equal(p.x, points[begin].x + step * i))
+            return false;
+    }
+    return count < 2 || !equal(step, 0);
+}
+
+// mean x-coordinate of count points starting at begin with given stride
+double meanX(const std::vector<double2> &points, int begin, int count, int stride) {
+    double sum = 0;
+    for (int i = 0; i < count; ++i)
+        sum += points[begin + i * stride].x;
+    return sum / count;
+}
+
+// set pad names or first number and increment
+void setNames(Footprint::Pad &pad, const std::vector<const ImportedPad *> &pads) {
+    // non-plated holes have no name
+    if (pads.front()->hole)
+        return;
+
+    int count = pads.size();
+    std::vector<int> numbers(count);
+    bool numeric = true;
+    for (int i = 0; i < count && numeric; ++i)
+        numeric = SExpr::toNumber(pads[i]->name, numbers[i]);
+    if (numeric) {
+        int increment = count >= 2 ? numbers[1] - numbers[0] : 1;
+        bool progression = increment >= 1;
+        for (int i = 1; i < count && progression; ++i)
+            progression = numbers[i] == numbers[0] + i * increment;
+        if (progression) {
+            pad.number = numbers[0];
+            pad.increment = increment;
+            return;
+        }
+    }
+    for (auto p : pads)
+        pad.names.emplace_back(p->name);
+}
+
+// try to reconstruct a pad array, returns false if the pads don't form a known pattern
+bool detectArray(Footprint::Pad &pad, const std::vector<const ImportedPad *> &pads, Footprint::Orientation o) {
+    int count = pads.size();
+    if (count < 2)
+        return false;
+
+    // positions in pad array coordinates
+    std::vector<double2> points;
+    for (auto p : pads)
+        points.push_back(unorient(p->position, o));
+    double2 offset = pads.front()->offset;
+
+    double y1, y2, step1, step2;
+    double2 center;
+    if (isRow(points, 0, count, 1, y1, step1)) {
+        // single line of pads
+        for (auto p : pads) {
+            if (!equal(p->offset, offset))
+                return false;
+        }
+        pad.type = Footprint::Pad::Type::SINGLE;
+        pad.pitch = std::abs(step1);
+        pad.mirror = step1 < 0;
+        center = {meanX(points, 0, count, 1), y1};
+    } else {
+        // two lines of pads
+        if (count % 2 != 0)
+            return false;
+        int half = count / 2;
+        int begin1 = 0, begin2 = half, stride = 1;
+        if (isRow(points, 0, half, 1, y1, step1) && isRow(points, half, half, 1, y2, step2) && equal(step1, -step2)) {
+            // circular numbering
+            pad.numbering = Footprint::Pad::Numbering::CIRCULAR;
+        } else if (isRow(points, 0, half, 1, y1, step1) && isRow(points, half, half, 1, y2, step2) && equal(step1, step2)) {
+            // numbering by rows
+            pad.numbering = Footprint::Pad::Numbering::ROWS;
+        } else if (isRow(points, 0, half, 2, y1, step1) && isRow(points, 1, half, 2, y2, step2) && equal(step1, step2)) {
+            // numbering by columns
+            pad.numbering = Footprint::Pad::Numbering::COLUMNS;
+            begin2 = 1;
+            stride = 2;
+        } else {
+            return false;
+        }
+        if (equal(y1, y2))
+            return false;
+
+        // pad offset of second row is mirrored
+        for (int i = 0; i < half; ++i) {
+            if (!equal(pads[begin1 + i * stride]->offset, offset) || !equal(pads[begin2 + i * stride]->offset, -offset))
+                return false;
+        }
+
+        double x1 = meanX(points, begin1, half, stride);
+        double x2 = meanX(points, begin2, half, stride);
+        pad.type = Footprint::Pad::Type::DUAL;
+        pad.pitch = std::abs(step1);
+        pad.mirror = step1 < 0;
+        pad.distance = snap(double2(y1 - y2, y1 - y2));
+        pad.shift = snap((x2 - x1) * 0.5);
+        center = {(x1 + x2) * 0.5, (y1 + y2) * 0.5};
+    }
+
+    pad.count = count;
+    pad.pitch = snap(pad.pitch);
+    pad.position = snap(orient(center, o));
+    pad.offset = snap(offset);
+    return true;
+}
+
+void setPad(Footprint::Pad &pad, const ImportedPad &p) {
+    pad.size = p.size;
+    pad.shape = p.shape;
+    pad.drillSize = p.drillSize;
+    pad.clearance = p.clearance;
+    pad.maskMargin = p.maskMargin;
+    pad.back = p.back;
+    pad.mask = p.mask;
+    pad.paste = p.paste;
+}
+
+// reconstruct pad arrays from the list of pads
+void reconstructPads(Footprint &footprint, const std::vector<ImportedPad> &pads) {
+    // group pads of same kind
+    std::vector<std::vector<const ImportedPad *>> groups;
+    for (auto &pad : pads) {
+        auto it = std::find_if(groups.begin(), groups.end(), [&pad](auto &group) {
+            return group.front()->sameKind(pad);
+        });
+        if (it == groups.end())
+            groups.emplace_back().push_back(&pad);
+        else
+            it->push_back(&pad);
+    }
+
+    // sort each group by number if all pads have numeric names, otherwise keep file order
+    for (auto &group : groups) {
+        std::vector<int> numbers(group.size());
+        bool numeric = true;
+        for (size_t i = 0; i < group.size() && numeric; ++i)
+            numeric = SExpr::toNumber(group[i]->name, numbers[i]);
+        if (numeric) {
+            std::stable_sort(group.begin(), group.end(), [](const ImportedPad *a, const ImportedPad *b) {
+                int na = 0, nb = 0;
+                SExpr::toNumber(a->name, na);
+                SExpr::toNumber(b->name, nb);
+                return na < nb;
+            });
+        }
+    }
+
+    // orientation of the footprint is given by the direction of the first pad array
+    for (auto &group : groups) {
+        if (group.size() < 2)
+            continue;
+        double2 min = group.front()->position;
+        double2 max = min;
+        for (auto p : group) {
+            min = {std::min(min.x, p->position.x), std::min(min.y, p->position.y)};
+            max = {std::max(max.x, p->position.x), std::max(max.y, p->position.y)};
+        }
+        if (max.y - min.y > max.x - min.x)
+            footprint.orientation = Footprint::Orientation::TOP_LEFT;
+        break;
+    }
+
+    for (auto &group : groups) {
+        Footprint::Pad pad;
+        setPad(pad, *group.front());
+        if (detectArray(pad, group, footprint.orientation)) {
+            setNames(pad, group);
+            footprint.pads.push_back(std::move(pad));
+        } else {
+            // no known pattern: add each pad on its own
+            for (auto p : group) {
+                Footprint::Pad &single = footprint.pads.emplace_back();
+                setPad(single, *p);
+                single.position = p->position;
+                single.offset = p->offset;
+                setNames(single, {p});
+            }
+        }
+    }
+}
+
+// join consecutive line segments to polylines
+void reconstructLines(Footprint &footprint, const std::vector<ImportedLine> &lines) {
+    Footprint::Line *current = nullptr;
+    const ImportedLine *last = nullptr;
+    for (auto &line : lines) {
+        if (current == nullptr || line.layer != last->layer || line.width != last->width
+            || !equal(line.start, last->end))
+        {
+            current = &footprint.lines.emplace_back();
+            current->layer = line.layer;
+            current->width = line.width;
+            current->points.push_back(line.start);
+        }
+        current->points.push_back(line.end);
+        last = &line;
+    }
+}
+
+} // namespace
+
+
+bool importKicad(const fs::path &path, std::string &name, Footprint &footprint) {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        reportError({}, "could not open file " + path.string());
+        return false;
+    }
+    SExpr p(file.data());
+
+    // header: (module name ...) or (footprint name ...)
+    if (p.next() != Token::OPEN) {
+        reportError({}, path.string() + ": not a footprint");
+        return false;
+    }
+    std::string_view keyword = p.keyword();
+    if ((keyword != "module" && keyword != "footprint") || p.next() != Token::ATOM) {
+        reportError({}, path.string() + ": not a footprint");
+        return false;
+    }
+    name = p.atom;
+    if (name.empty())
+        name = path.stem().string();
+
+    std::vector<ImportedPad> pads;
+    std::vector<ImportedLine> lines;
+    while (true) {
+        Token t = p.next();
+        if (t == Token::CLOSE)
+            break;
+        if (t == Token::END) {
+            reportError({}, path.string() + ": unexpected end of file");
+            return false;
+        }
+        if (t != Token::OPEN)
+            continue;
+
+        keyword = p.keyword();
+        if (keyword == "descr") {
+            footprint.description = p.value();
+        } else if (keyword == "attr") {
+            auto attr = p.value();
+            if (attr == "smd")
+                footprint.type = Footprint::Type::SMD;
+            else if (attr == "through_hole")
+                footprint.type = Footprint::Type::THROUGH_HOLE;
+        } else if (keyword == "pad") {
+            readPad(p, pads.emplace_back());
+        } else if (keyword == "fp_line") {
+            readLine(p, lines.emplace_back());
+        } else if (keyword == "fp_rect") {
+            readRectangle(p, lines);
+        } else if (keyword == "fp_poly") {
+            readPolygon(p, lines);
+        } else if (keyword == "fp_circle") {
+            readCircle(p, footprint.circles.emplace_back());
+        } else {
+            p.skipList();
+        }
+    }
+
+    reconstructPads(footprint, pads);
+    reconstructLines(footprint, lines);
+    return true;
+}
+
+int importKicadLibrary(const fs::path &path, std::map<std::string, Footprint> &footprints) {
+    std::vector<fs::path> files;
+    if (fs::is_directory(path)) {
+        for (auto &entry : fs::directory_iterator(path)) {
+            if (entry.path().extension() == ".kicad_mod")
+                files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+    } else {
+        files.push_back(path);
+    }
+
+    int count = 0;
+    for (auto &file : files) {
+        std::string name;
+        Footprint footprint;
+        if (importKicad(file, name, footprint)) {
+            footprints[name] = std::move(footprint);
+            ++count;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Footprint.hpp"
+#include <filesystem>
+#include <map>
+#include <string>
+
+
+namespace fs = std::filesystem;
+
+
+// import a .kicad_mod file, returns false and reports an error if the file could not be read or parsed
+bool importKicad(const fs::path &path, std::string &name, Footprint &footprint);
+
+// import a .kicad_mod file or all .kicad_mod files of a .pretty directory, returns number of imported footprints
+int importKicadLibrary(const fs::path &path, std::map<std::string, Footprint> &footprints);
@@ -0,0 +1,908 @@
+#include "layoutFootprint.hpp"
+#include "clipper2.hpp"
+#include "MemoryStats.hpp"
+#include "Scheduler.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+
+// transformation from pad array coordinates (pin 1 marker at bottom left) to footprint coordinates
+struct Orient {
+    double xx, xy;
+    double yx, yy;
+
+    constexpr double2 operator ()(double x, double y) const {
+        return {this->xx * x + this->xy * y, this->yx * x + this->yy * y};
+    }
+};
+
+// transformations indexed by Footprint::Orientation
+constexpr Orient orientations[] = {
+    { 1,  0,  0,  1}, // BOTTOM_LEFT: ( x,  y)
+    { 0,  1, -1,  0}, // BOTTOM_RIGHT: ( y, -x)
+    { 0, -1,  1,  0}, // TOP_LEFT: (-y,  x)
+    {-1,  0,  0, -1}, // TOP_RIGHT: (-x, -y)
+};
+
+inline double2 orient(double x, double y, Footprint::Orientation o) {
+    return orientations[int(o)](x, y);
+}
+
+
+constexpr double silkscreenWidth = 0.15;
+constexpr double silkscreenDistance = 0.1;
+constexpr double padClearance = 0.1;
+
+// add a rectangle pith pin 1 indicator to silscreen subjects
+void addSilkscreenRectangle(clipper2::Paths64 &openSubjects, clipper2::Paths64 &closedSubjects, double2 center,
+    double2 size, Footprint::Orientation o)
+{
+    double w = size.x;
+    double h = size.y;
+    if (o == Footprint::Orientation::BOTTOM_RIGHT || o == Footprint::Orientation::TOP_LEFT) {
+        // swap width and height
+        w = size.y;
+        h = size.x;
+    }
+
+    double x1 = - w * 0.5;
+    double y1 = + h * 0.5;
+    double x2 = + w * 0.5;
+    double y2 = - h * 0.5;
+
+    double d = 4 * silkscreenWidth;
+
+    double x = x1 + (x2 > x1 ? d : -d);
+    double y = y1 + (y2 > y1 ? d : -d);
+
+    {
+        clipper2::Path64 &path = openSubjects.emplace_back();
+        path.push_back(toClipperPoint(center + orient(x, y1, o)));
+        path.push_back(toClipperPoint(center + orient(x2, y1, o)));
+        path.push_back(toClipperPoint(center + orient(x2, y2, o)));
+        path.push_back(toClipperPoint(center + orient(x1, y2, o)));
+        path.push_back(toClipperPoint(center + orient(x1, y, o)));
+    }
+
+    // add pin1 indicator
+    {
+        clipper2::Path64 &path = closedSubjects.emplace_back();
+        double w = silkscreenWidth * 0.5;
+        path.push_back(toClipperPoint(center + orient(x1 - w, y1 - w, o)));
+        path.push_back(toClipperPoint(center + orient(x1 + w, y1 - w, o)));
+        path.push_back(toClipperPoint(center + orient(x1 + w, y1 + w, o)));
+        path.push_back(toClipperPoint(center + orient(x1 - w, y1 + w, o)));
+    }
+}
+
+// arc tolerance of pad clearance outlines in mm
+constexpr double clearanceArcTolerance = 0.005;
+
+// shapes that clip away the silkscreen. The clearance outline of a pad is generated once per unique pad shape and
+// translated to each pad, so the vertex work is proportional to the number of unique shapes
+class SilkscreenClips {
+public:
+    // add the clearance outline of a pad, the pad covers the drill
+    void addPad(double2 center, double2 size, double shape, double2 drill) {
+        auto &outline = getOutline(size, shape, drill);
+        auto offset = toClipperPoint(center);
+        clipper2::Path64 &path = this->paths.emplace_back();
+        path.reserve(outline.size());
+        for (auto &p : outline)
+            path.emplace_back(p.x + offset.x, p.y + offset.y);
+    }
+
+    clipper2::Paths64 paths;
+
+protected:
+    // the outline is keyed by size, shape and drill only. The clearance to the silkscreen is the constant padClearance
+    // for all pads, pad.clearance is the copper clearance of the pad and does not apply to the silkscreen
+    const clipper2::Path64 &getOutline(double2 size, double shape, double2 drill) {
+        for (auto &outline : this->outlines) {
+            if (outline.size.x == size.x && outline.size.y == size.y && outline.shape == shape
+                && outline.drill.x == drill.x && outline.drill.y == drill.y)
+            {
+                return outline.path;
+            }
+        }
+        return this->outlines.emplace_back(Outline{size, shape, drill, makeOutline(size, shape, drill)}).path;
+    }
+
+    // generate the clearance outline of a pad at the origin by offsetting the pad shape
+    static clipper2::Path64 makeOutline(double2 size, double shape, double2 drill) {
+        // a hole without pad is round
+        if (!size.positive())
+            shape = CIRCLE;
+        double w = std::max(size.x, drill.x);
+        double h = std::max(size.y, drill.y);
+
+        // corner radius
+        double radius = shape <= RECTANGLE ? 0 : std::min(w, h) * std::min(shape, CIRCLE);
+
+        // rectangle without the rounded corners which gets inflated by corner radius plus clearance
+        int64_t x = toClipperValue(w * 0.5 - radius);
+        int64_t y = toClipperValue(h * 0.5 - radius);
+        double delta = (radius + silkscreenWidth * 0.5 + padClearance) * clipperFactor;
+        double arcTolerance = clearanceArcTolerance * clipperFactor;
+        clipper2::Paths64 paths;
+        clipper2::Paths64 outline;
+        if (x > 0 && y > 0) {
+            paths.push_back({{-x, -y}, {x, -y}, {x, y}, {-x, y}});
+            outline = clipper2::InflatePaths(paths, delta, clipper2::JoinType::Round, clipper2::EndType::Polygon,
+                2.0, arcTolerance);
+        } else {
+            // oval or circle: inflate a line or a point
+            if (x > 0 || y > 0)
+                paths.push_back({{-x, -y}, {x, y}});
+            else
+                paths.push_back({{0, 0}});
+            outline = clipper2::InflatePaths(paths, delta, clipper2::JoinType::Round, clipper2::EndType::Round,
+                2.0, arcTolerance);
+        }
+        return outline.empty() ? clipper2::Path64() : std::move(outline.front());
+    }
+
+    struct Outline {
+        double2 size;
+        double shape;
+        double2 drill;
+        clipper2::Path64 path;
+    };
+    std::vector<Outline> outlines;
+};
+
+
+/*
+void silkscreenRectangle(std::ofstream &s, double2 center, double2 size) {
+    double x1 = center.x - size.x * 0.5;
+    double y1 = center.y + size.y * 0.5;
+    double x2 = center.x + size.x * 0.5;
+    double y2 = center.y - size.y * 0.5;
+
+    double d = 4 * silkscreenWidth;
+    double x = x1 + (x2 > x1 ? d : -d);
+    double y = y1 + (y2 > y1 ? d : -d);
+
+    // pin 1 marking
+    line(s, {x1, y1}, {x1, y1}, silkscreenWidth * 2, "F.SilkS");
+
+    // remaining rectangle
+    line(s, {x, y1}, {x2, y1}, silkscreenWidth, "F.SilkS");
+    line(s, {x2, y1}, {x2, y2}, silkscreenWidth, "F.SilkS");
+    line(s, {x2, y2}, {x1, y2}, silkscreenWidth, "F.SilkS");
+    line(s, {x1, y2}, {x1, y}, silkscreenWidth, "F.SilkS");
+}*/
+
+// maximum distance in clipper units of a vertex from the line through its neighbors to be removed from clipped paths,
+// removes collinear and near-duplicate vertices left by clipping
+constexpr double silkscreenSimplifyEpsilon = 2;
+
+void writeSilkscreenPaths(FootprintSink &sink, const clipper2::Paths64 &paths, bool closed) {
+    std::vector<double2> points;
+    for (auto &path : clipper2::SimplifyPaths(paths, silkscreenSimplifyEpsilon, closed)) {
+        if (path.size() < 2)
+            continue;
+        points.clear();
+        for (auto &p : path)
+            points.push_back(toPoint(p));
+        sink.polyline(points, closed, silkscreenWidth, "F.SilkS");
+    }
+}
+
+// number of clip shapes (pads) above which the silkscreen is clipped in parallel tiles
+constexpr int tiledClipThreshold = 512;
+
+// minimum number of clip shapes per tile
+constexpr int clipsPerTile = 128;
+
+inline bool overlaps(const clipper2::Rect64 &a, const clipper2::Rect64 &b) {
+    return a.left <= b.right && a.right >= b.left && a.top <= b.bottom && a.bottom >= b.top;
+}
+
+inline bool collinear(const clipper2::Point64 &a, const clipper2::Point64 &b, const clipper2::Point64 &c) {
+    return (b.x - a.x) * (c.y - b.y) == (b.y - a.y) * (c.x - b.x);
+}
+
+// append path b to path a, the last point of a is the first point of b
+static void joinPath(clipper2::Path64 &a, const clipper2::Path64 &b) {
+    a.pop_back();
+    size_t joint = a.size();
+    a.insert(a.end(), b.begin(), b.end());
+
+    // remove the joint if it was only introduced by the tile boundary
+    if (joint > 0 && joint + 1 < a.size() && collinear(a[joint - 1], a[joint], a[joint + 1]))
+        a.erase(a.begin() + joint);
+}
+
+// join open paths that were cut at tile boundaries. Paths are processed in order so that the result is deterministic
+static clipper2::Paths64 stitchPaths(clipper2::Paths64 &paths) {
+    // map from end point to path ends (path index * 2 + 0 for start or 1 for end)
+    std::map<std::pair<int64_t, int64_t>, std::vector<int>> ends;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ends[{paths[i].front().x, paths[i].front().y}].push_back(int(i) * 2);
+        ends[{paths[i].back().x, paths[i].back().y}].push_back(int(i) * 2 + 1);
+    }
+
+    // find the other path end at a point, only if exactly two ends meet
+    auto next = [&ends](const clipper2::Point64 &p, int self) {
+        auto &list = ends[{p.x, p.y}];
+        if (list.size() != 2)
+            return -1;
+        return list[0] == self ? list[1] : list[0];
+    };
+
+    std::vector<bool> used(paths.size());
+    clipper2::Paths64 result;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (used[i])
+            continue;
+        used[i] = true;
+        clipper2::Path64 path = std::move(paths[i]);
+
+        // extend at the end
+        int end = int(i) * 2 + 1;
+        while (true) {
+            int other = next(path.back(), end);
+            if (other < 0 || used[other / 2])
+                break;
+            used[other / 2] = true;
+            auto &b = paths[other / 2];
+            if (other & 1)
+                std::reverse(b.begin(), b.end());
+            joinPath(path, b);
+            end = (other ^ 1);
+        }
+
+        // extend at the start
+        int start = int(i) * 2;
+        while (true) {
+            int other = next(path.front(), start);
+            if (other < 0 || used[other / 2])
+                break;
+            used[other / 2] = true;
+            auto b = std::move(paths[other / 2]);
+            if (!(other & 1))
+                std::reverse(b.begin(), b.end());
+            joinPath(b, path);
+            path = std::move(b);
+            start = (other ^ 1);
+        }
+
+        result.push_back(std::move(path));
+    }
+    return result;
+}
+
+// subtract the clip shapes from the silkscreen. Footprints with many pads (large connectors, test point arrays, grids)
+// are partitioned into strips along the longer axis which are clipped as subtasks on the workers of the scheduler and
+// stitched back together
+static void clipSilkscreen(const clipper2::Paths64 &openSubjects, const clipper2::Paths64 &closedSubjects,
+    const clipper2::Paths64 &clips, clipper2::Paths64 &closedPaths, clipper2::Paths64 &openPaths)
+{
+    MemoryScope scope(MemoryStage::CLIP);
+    auto scheduler = Scheduler::getCurrent();
+    int threadCount = scheduler != nullptr ? scheduler->getThreadCount() : 1;
+    int tileCount = std::min(int(clips.size()) / clipsPerTile, threadCount);
+    if (clips.size() < tiledClipThreshold || tileCount < 2) {
+        clipper2::Clipper64 clipper;
+        clipper.AddOpenSubject(openSubjects);
+        clipper.AddSubject(closedSubjects);
+        clipper.AddClip(clips);
+        clipper.Execute(clipper2::ClipType::Difference, clipper2::FillRule::NonZero, closedPaths, openPaths);
+        return;
+    }
+
+    // bounds of all shapes, extended so that no subject lies on the outer boundary
+    clipper2::Rect64 bounds = clipper2::GetBounds(openSubjects);
+    std::vector<clipper2::Rect64> clipBounds;
+    clipBounds.reserve(clips.size());
+    for (auto &clip : clips) {
+        auto &b = clipBounds.emplace_back(clipper2::GetBounds(clip));
+        bounds.left = std::min(bounds.left, b.left);
+        bounds.top = std::min(bounds.top, b.top);
+        bounds.right = std::max(bounds.right, b.right);
+        bounds.bottom = std::max(bounds.bottom, b.bottom);
+    }
+    bounds.left -= 1;
+    bounds.top -= 1;
+    bounds.right += 1;
+    bounds.bottom += 1;
+    bool horizontal = bounds.right - bounds.left >= bounds.bottom - bounds.top;
+
+    // tile boundaries at quantiles of the clip centers so that each tile gets a similar number of clips
+    std::vector<int64_t> centers;
+    centers.reserve(clips.size());
+    for (auto &b : clipBounds)
+        centers.push_back(horizontal ? (b.left + b.right) / 2 : (b.top + b.bottom) / 2);
+    std::sort(centers.begin(), centers.end());
+
+    // coordinates of subject vertices, a boundary must not coincide with a subject edge along the boundary
+    std::vector<int64_t> vertices;
+    for (auto &path : openSubjects) {
+        for (auto &p : path)
+            vertices.push_back(horizontal ? p.x : p.y);
+    }
+
+    std::vector<int64_t> boundaries = {horizontal ? bounds.left : bounds.top};
+    for (int i = 1; i < tileCount; ++i) {
+        int j = clips.size() * i / tileCount;
+        int64_t boundary = (centers[j - 1] + centers[j]) / 2;
+        while (std::find(vertices.begin(), vertices.end(), boundary) != vertices.end())
+            ++boundary;
+        if (boundary > boundaries.back())
+            boundaries.push_back(boundary);
+    }
+    boundaries.push_back(horizontal ? bounds.right : bounds.bottom);
+    tileCount = boundaries.size() - 1;
+
+    // clip the tiles in parallel
+    std::vector<clipper2::Paths64> tilePaths(tileCount);
+    auto clipTile = [&](int i) {
+        MemoryScope tileScope(MemoryStage::CLIP, scope);
+        clipper2::Rect64 rect = bounds;
+        if (horizontal) {
+            rect.left = boundaries[i];
+            rect.right = boundaries[i + 1];
+        } else {
+            rect.top = boundaries[i];
+            rect.bottom = boundaries[i + 1];
+        }
+        clipper2::Paths64 tileClips;
+        for (size_t j = 0; j < clips.size(); ++j) {
+            if (overlaps(rect, clipBounds[j]))
+                tileClips.push_back(clips[j]);
+        }
+        clipper2::Clipper64 clipper;
+        clipper.AddOpenSubject(clipper2::RectClipLines(rect, openSubjects));
+        clipper.AddClip(tileClips);
+        clipper2::Paths64 closed;
+        clipper.Execute(clipper2::ClipType::Difference, clipper2::FillRule::NonZero, closed, tilePaths[i]);
+    };
+    scheduler->forEach(tileCount, clipTile);
+    if (!closedSubjects.empty()) {
+        // pin 1 indicator
+        auto rect = clipper2::GetBounds(closedSubjects);
+        clipper2::Paths64 rectClips;
+        for (size_t j = 0; j < clips.size(); ++j) {
+            if (overlaps(rect, clipBounds[j]))
+                rectClips.push_back(clips[j]);
+        }
+        clipper2::Clipper64 clipper;
+        clipper.AddSubject(closedSubjects);
+        clipper.AddClip(rectClips);
+        clipper2::Paths64 open;
+        clipper.Execute(clipper2::ClipType::Difference, clipper2::FillRule::NonZero, closedPaths, open);
+    }
+
+    // stitch the open paths of all tiles in tile order
+    clipper2::Paths64 paths;
+    for (auto &tile : tilePaths) {
+        for (auto &path : tile) {
+            if (path.size() >= 2)
+                paths.push_back(std::move(path));
+        }
+    }
+    openPaths = stitchPaths(paths);
+}
+
+constexpr double fabWidth = 0.15;
+constexpr double fabDistance = 0.2;
+
+void writeFabRectangle(FootprintSink &sink, double2 center, double2 size, Footprint::Orientation o) {
+    double w = size.x;
+    double h = size.y;
+    if (o == Footprint::Orientation::BOTTOM_RIGHT || o == Footprint::Orientation::TOP_LEFT) {
+        // swap width and height
+        w = size.y;
+        h = size.x;
+    }
+
+    double x1 = - w * 0.5;
+    double y1 = + h * 0.5;
+    double x2 = + w * 0.5;
+    double y2 = - h * 0.5;
+
+    double d = std::min(std::abs(size.x), std::abs(size.y)) * 0.25;
+    double x = x1 + (x2 > x1 ? d : -d);
+    double y = y1 + (y2 > y1 ? d : -d);
+
+    // outline with chamfered pin 1 corner
+    std::vector<double2> points = {
+        center + orient(x1, y, o),
+        center + orient(x, y1, o),
+        center + orient(x2, y1, o),
+        center + orient(x2, y2, o),
+        center + orient(x1, y2, o)};
+    sink.polyline(points, true, silkscreenWidth, "F.Fab");
+}
+
+// write single line of pads, specialized on orientation
+template <Footprint::Orientation O>
+void writeSingle(FootprintSink &sink, const Footprint &footprint, const Footprint::Pad &pad, SilkscreenClips &clips) {
+    constexpr Orient o = orientations[int(O)];
+    int count = pad.count;
+    bool hasPad = pad.size.positive();
+    bool hasDrill = pad.drillSize.positive();
+
+    double start = pad.pitch * (count - 1) * 0.5;
+
+    // position of first pin
+    double2 position = footprint.position + pad.position + o(-start, 0);
+
+    // advance along the pad line
+    double2 pitch = o(pad.pitch, 0);
+
+    // offset of pad relative to drill
+    double2 padOffset = {0, 0};
+
+    // adjust position/offset depending on drill
+    if (!hasDrill) {
+        position += pad.offset;
+    } else {
+        position += pad.drillOffset;
+        if (hasPad)
+            padOffset = pad.offset - pad.drillOffset;
+    }
+
+    // index of first pin and index increment (mirror)
+    int first = pad.mirror ? count - 1 : 0;
+    int step = pad.mirror ? -1 : 1;
+
+    // double pins share one number
+    int shift = pad.double_ ? 1 : 0;
+
+    // generate pins
+    for (int i = 0; i < count; ++i) {
+        int n = (first + i * step) >> shift;
+
+        if (pad.exists(n)) {
+            sink.pad(pad.getName(n), position, pad.size, padOffset, pad.shape, pad.drillSize, pad);
+            clips.addPad(position, pad.size, pad.shape, pad.drillSize);
+        }
+        position += pitch;
+    }
+}
+
+// write two lines of pads, specialized on orientation and numbering
+template <Footprint::Orientation O, Footprint::Pad::Numbering N>
+void writeDual(FootprintSink &sink, const Footprint &footprint, const Footprint::Pad &pad, SilkscreenClips &clips) {
+    constexpr Orient o = orientations[int(O)];
+    int count = pad.count / 2;
+    bool hasPad = pad.size.positive();
+    bool hasDrill = pad.drillSize.positive();
+
+    double padDistance = pad.distance.x;
+
+    // center position of pads
+    double2 position = footprint.position + pad.position;
+
+    // shift
+    double shift = pad.shift;
+
+    // offset of pad relative to drill
+    double2 padOffset1 = {0, 0};
+    double2 padOffset2 = {0, 0};
+
+    double start1 = pad.pitch * (count - 1) * 0.5 + shift;
+    double start2 = pad.pitch * (count - 1) * 0.5 - shift;
+
+    // position of first pin in each row
+    double2 position1 = position + o(-start1, padDistance * 0.5);
+    double2 position2 = position + o(-start2, padDistance * -0.5);
+
+    // advance along the pad lines
+    double2 pitch = o(pad.pitch, 0);
+
+    // adjust position/offset depending on drill
+    if (!hasDrill) {
+        position1 += pad.offset;
+        position2 -= pad.offset;
+    } else {
+        position1 += pad.drillOffset;
+        position2 -= pad.drillOffset;
+        if (hasPad) {
+            padOffset1 = pad.offset - pad.drillOffset;
+            padOffset2 = -padOffset1;
+        }
+    }
+
+    // index of first pin and index increment (mirror)
+    int first = pad.mirror ? count - 1 : 0;
+    int step = pad.mirror ? -1 : 1;
+
+    // double pins share one number
+    int doubleShift = pad.double_ ? 1 : 0;
+
+    // generate pins
+    for (int i = 0; i < count; ++i) {
+        int index = first + i * step;
+
+        int n1, n2;
+        if constexpr (N == Footprint::Pad::Numbering::CIRCULAR) {
+            // circular numbering
+            n1 = index;
+            n2 = pad.count - 1 - index;
+        } else if constexpr (N == Footprint::Pad::Numbering::COLUMNS) {
+            // number by columns (zigzag)
+            n1 = index * 2;
+            n2 = index * 2 + 1;
+        } else {
+            // number by rows
+            n1 = index;
+            n2 = count + index;
+        }
+        n1 >>= doubleShift;
+        n2 >>= doubleShift;
+
+        // first row
+        if (pad.exists(n1)) {
+            sink.pad(pad.getName(n1), position1, pad.size, padOffset1, pad.shape, pad.drillSize, pad);
+            clips.addPad(position1, pad.size, pad.shape, pad.drillSize);
+        }
+
+        // second row
+        if (pad.exists(n2)) {
+            sink.pad(pad.getName(n2), position2, pad.size, padOffset2, pad.shape, pad.drillSize, pad);
+            clips.addPad(position2, pad.size, pad.shape, pad.drillSize);
+        }
+
+        // increment position
+        position1 += pitch;
+        position2 += pitch;
+    }
+}
+
+double2 rot90(double2 p) {
+    return {p.y, p.x};
+}
+
+double2 swap(double2 p) {
+    return {p.y, p.x};
+}
+
+// write quad (e.g. QFP)
+void writeQuad(FootprintSink &sink, double2 globalPosition, const Footprint::Pad &pad, SilkscreenClips &clips) {
+    int count = pad.count / 4;
+    bool hasPad = pad.size.positive();
+    bool hasDrill = pad.drillSize.positive();
+
+    // position of first pin in each row
+    double2 position1 = globalPosition + pad.position + double2((pad.pitch * (count - 1)) * -0.5, pad.distance.x * 0.5);
+    double2 position2 = globalPosition + pad.position + double2(pad.distance.y * 0.5, (pad.pitch * (count - 1)) * 0.5);
+    double2 position3 = globalPosition + pad.position + double2((pad.pitch * (count - 1)) * 0.5, pad.distance.x * -0.5);
+    double2 position4 = globalPosition + pad.position + double2(pad.distance.y * -0.5, (pad.pitch * (count - 1)) * -0.5);
+
+    // offset of pad relative to drill
+    double2 padOffset1 = {0, 0};
+    double2 padOffset2 = {0, 0};
+    double2 padOffset3 = {0, 0};
+    double2 padOffset4 = {0, 0};
+
+    if (!hasDrill) {
+        position1 += pad.offset;
+        position2 += rot90(pad.offset);
+        position3 -= pad.offset;
+        position4 -= rot90(pad.offset);
+    } else {
+        position1 += pad.drillOffset;
+        position2 += rot90(pad.drillOffset);
+        position3 -= pad.drillOffset;
+        position4 -= rot90(pad.drillOffset);
+        if (hasPad) {
+            padOffset1 = pad.offset - pad.drillOffset;
+            padOffset2 = rot90(pad.offset - pad.drillOffset);
+            padOffset3 = -padOffset1;
+            padOffset4 = -padOffset3;
+        }
+    }
+
+    double2 padSize24 = swap(pad.size);
+
+    // generate pins
+    for (int i = 0; i < count; ++i) {
+        int index = pad.mirror ? count - 1 - i : i;
+
+        int n1 = index;
+        int n2 = count + index;
+        int n3 = count * 2 + index;
+        int n4 = count * 3 + index;
+
+        if (pad.exists(n1)) {
+            sink.pad(pad.getName(n1), position1, pad.size, padOffset1, pad.shape, pad.drillSize, pad);
+            clips.addPad(position1, pad.size, pad.shape, pad.drillSize);
+        }
+        if (pad.exists(n2)) {
+            sink.pad(pad.getName(n2), position2, padSize24, padOffset2, pad.shape, swap(pad.drillSize), pad);
+            clips.addPad(position2, padSize24, pad.shape, swap(pad.drillSize));
+        }
+        if (pad.exists(n3)) {
+            sink.pad(pad.getName(n3), position3, pad.size, padOffset3, pad.shape, pad.drillSize, pad);
+            clips.addPad(position3, pad.size, pad.shape, pad.drillSize);
+        }
+        if (pad.exists(n4)) {
+            sink.pad(pad.getName(n4), position4, padSize24, padOffset4, pad.shape, swap(pad.drillSize), pad);
+            clips.addPad(position4, padSize24, pad.shape, swap(pad.drillSize));
+        }
+
+        // increment position
+        position1.x += pad.pitch;
+        position2.y -= pad.pitch;
+        position3.x -= pad.pitch;
+        position4.y += pad.pitch;
+    }
+
+}
+
+// generate grid (e.g. BGA)
+void writeGrid(FootprintSink &sink, double2 globalPosition, const Footprint::Pad &pad, SilkscreenClips &clips) {
+
+}
+
+using PadArrayWriter = void (*)(FootprintSink &, const Footprint &, const Footprint::Pad &, SilkscreenClips &);
+
+// write a pad array, specialized on pad array type, orientation and numbering
+template <Footprint::Pad::Type T, Footprint::Orientation O, Footprint::Pad::Numbering N>
+void writePadArray(FootprintSink &sink, const Footprint &footprint, const Footprint::Pad &pad, SilkscreenClips &clips) {
+    if constexpr (T == Footprint::Pad::Type::SINGLE)
+        writeSingle<O>(sink, footprint, pad, clips);
+    else if constexpr (T == Footprint::Pad::Type::DUAL)
+        writeDual<O, N>(sink, footprint, pad, clips);
+    else if constexpr (T == Footprint::Pad::Type::QUAD)
+        writeQuad(sink, footprint.position, pad, clips);
+    else
+        writeGrid(sink, footprint.position, pad, clips);
+}
+
+template <size_t... I>
+constexpr std::array<PadArrayWriter, sizeof...(I)> makePadArrayWriters(std::index_sequence<I...>) {
+    return {writePadArray<Footprint::Pad::Type(I / 12), Footprint::Orientation(I / 3 % 4), Footprint::Pad::Numbering(I % 3)>...};
+}
+
+// table of pad array writers indexed by (type * 4 + orientation) * 3 + numbering
+constexpr auto padArrayWriters = makePadArrayWriters(std::make_index_sequence<4 * 4 * 3>());
+
+// write a pad array, dispatches once per pad array to the specialized writer
+inline void writePadArray(FootprintSink &sink, const Footprint &footprint, const Footprint::Pad &pad, SilkscreenClips &clips) {
+    int index = (int(pad.type) * 4 + int(footprint.orientation)) * 3 + int(pad.numbering);
+    padArrayWriters[index](sink, footprint, pad, clips);
+}
+
+// pad array with its silkscreen clips, shared by footprints that have the same pad array at the same position
+struct CachedPadArray {
+    PadBlock block;
+    clipper2::Paths64 clips;
+};
+
+std::shared_ptr<const CachedPadArray> PadArrayCache::get(const std::string &key) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->map.find(key);
+    if (it == this->map.end())
+        return nullptr;
+    this->list.splice(this->list.begin(), this->list, it->second);
+    return it->second->second;
+}
+
+std::shared_ptr<const CachedPadArray> PadArrayCache::add(const std::string &key,
+    std::shared_ptr<const CachedPadArray> padArray)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->map.find(key);
+    if (it != this->map.end()) {
+        this->list.splice(this->list.begin(), this->list, it->second);
+        return it->second->second;
+    }
+    if (this->list.size() >= this->capacity && !this->list.empty()) {
+        this->map.erase(this->list.back().first);
+        this->list.pop_back();
+    }
+    this->list.emplace_front(key, std::move(padArray));
+    this->map.emplace(this->list.front().first, this->list.begin());
+    return this->list.front().second;
+}
+
+// records the pads of a pad array into a block
+class PadBlockRecorder : public FootprintSink {
+public:
+    explicit PadBlockRecorder(PadBlock &block) : block(block) {}
+
+    void pad(std::string_view name, double2 position, double2 size, double2 offset, double shape,
+        double2 drillSize, const Footprint::Pad &pad) override
+    {
+        this->block.pads.push_back({std::string(name), position, size, offset, shape, drillSize});
+    }
+
+protected:
+    PadBlock &block;
+};
+
+// writes the fields of a pad array as text separated by ';', so that equal values give equal keys
+class PadArrayKey {
+public:
+    void add(double value) {
+        // -0.0 + 0.0 is 0.0
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value + 0.0);
+        this->key.append(buffer, result.ptr);
+        this->key += ';';
+    }
+
+    void add(double2 value) {
+        add(value.x);
+        add(value.y);
+    }
+
+    void add(int value) {
+        this->key += std::to_string(value);
+        this->key += ';';
+    }
+
+    void add(bool value) {
+        this->key += value ? '1' : '0';
+        this->key += ';';
+    }
+
+    template <typename E> requires std::is_enum_v<E>
+    void add(E value) {
+        add(int(value));
+    }
+
+    void add(const std::string &value) {
+        add(int(value.size()));
+        this->key += value;
+    }
+
+    std::string key;
+};
+
+// key of a pad array from all parameters that affect the generated pads and their formatting
+static std::string getPadArrayKey(const Footprint &footprint, const Footprint::Pad &pad) {
+    PadArrayKey key;
+    key.add(footprint.position);
+    key.add(footprint.orientation);
+    key.add(pad.type);
+    key.add(pad.position);
+    key.add(pad.distance);
+    key.add(pad.pitch);
+    key.add(pad.shift);
+    key.add(pad.size);
+    key.add(pad.offset);
+    key.add(pad.shape);
+    key.add(pad.drillSize);
+    key.add(pad.drillOffset);
+    key.add(pad.clearance);
+    key.add(pad.maskMargin);
+    key.add(pad.back);
+    key.add(pad.jumper);
+    key.add(pad.mask);
+    key.add(pad.paste);
+    key.add(pad.vertical);
+    key.add(pad.count);
+    key.add(pad.mirror);
+    key.add(pad.numbering);
+    key.add(pad.double_);
+    key.add(pad.number);
+    key.add(pad.increment);
+    key.add(int(pad.names.size()));
+    for (auto &name : pad.names)
+        key.add(name);
+    return std::move(key.key);
+}
+
+// write a pad array, the pads and their silkscreen clips are generated only once for footprints that share the pad
+// array and sinks can reuse their formatted output
+void writeCachedPadArray(FootprintSink &sink, const Footprint &footprint, const Footprint::Pad &pad,
+    SilkscreenClips &clips, PadArrayCache &padArrays)
+{
+    auto key = getPadArrayKey(footprint, pad);
+    auto cached = padArrays.get(key);
+    if (cached != nullptr) {
+        clips.paths.insert(clips.paths.end(), cached->clips.begin(), cached->clips.end());
+    } else {
+        // generate outside of the lock, if two threads generate the same pad array the first one wins
+        auto generated = std::make_shared<CachedPadArray>();
+        generated->block.pad = pad;
+        PadBlockRecorder recorder(generated->block);
+        size_t begin = clips.paths.size();
+        writePadArray(recorder, footprint, pad, clips);
+        generated->clips.assign(clips.paths.begin() + begin, clips.paths.end());
+        cached = padArrays.add(key, std::move(generated));
+    }
+    sink.padBlock(cached->block);
+}
+
+// center of the 3D model in 3D coordinates (y up)
+static double3 getModelCenter(const Footprint &footprint) {
+    double3 center = footprint.body.offset + double3(footprint.position.x, footprint.position.y, 0);
+    center.y = -center.y;
+    return center;
+}
+
+void layoutFootprint(const std::string &name, const Footprint &footprint, FootprintSink &sink,
+    PadArrayCache *padArrays)
+{
+    double2 position = footprint.position + footprint.body.offset.xy();
+
+    auto bodySize =  footprint.body.size.xy();
+    bool haveBody = bodySize.positive();
+
+    double2 silkscreenSize = bodySize + footprint.silkscreenAdd;
+    bool haveSilkscreen = footprint.silkscreen && silkscreenSize.positive();
+
+    double2 courtyardSize = bodySize + footprint.courtyardAdd;
+    bool haveCourtyard = footprint.courtyard && courtyardSize.positive();
+
+
+    // apply mirror to size so that pin1 marker is placed at the right position
+    if (!footprint.pads.empty() && footprint.pads.front().mirror) {
+        bodySize.x *= -1;
+        silkscreenSize.x *= -1;
+    }
+
+
+    sink.begin(name, footprint, haveBody);
+
+    // silkscreen
+    clipper2::Paths64 openSubjects;
+    clipper2::Paths64 closedSubjects;
+    SilkscreenClips clips; // shapes that clip away the silkscreen, e.g. pads
+
+    // body
+    if (haveBody) {
+        // 3D model (y up)
+        sink.body(getModelCenter(footprint), footprint.body.size);
+
+        // fabrication layer
+        writeFabRectangle(sink, position, bodySize, footprint.orientation);
+    }
+
+    if (haveSilkscreen)
+        addSilkscreenRectangle(openSubjects, closedSubjects, position, silkscreenSize, footprint.orientation);
+
+    // courtyard
+    if (haveCourtyard)
+        sink.rectangle(position, courtyardSize, 0.05, "F.CrtYd");
+
+    // pads
+    for (auto &pad : footprint.pads) {
+        if (padArrays != nullptr)
+            writeCachedPadArray(sink, footprint, pad, clips, *padArrays);
+        else
+            writePadArray(sink, footprint, pad, clips);
+    }
+
+    // lines
+    for (auto &line : footprint.lines) {
+        sink.line(footprint.position, line);
+    }
+
+    // circles
+    for (auto &circle : footprint.circles) {
+        sink.circle(footprint.position, circle);
+    }
+
+    // silkscreen
+    if (haveSilkscreen) {
+        // subtract pads from silkscreen
+        clipper2::Paths64 closedPahts;
+        clipper2::Paths64 openPaths;
+        clipSilkscreen(openSubjects, closedSubjects, clips.paths, closedPahts, openPaths);
+        writeSilkscreenPaths(sink, closedPahts, true);
+        writeSilkscreenPaths(sink, openPaths, false);
+    }
+
+    sink.end();
+}
+
+void layoutModel(const std::string &name, const Footprint &footprint, FootprintSink &sink) {
+    bool haveBody = footprint.body.size.xy().positive();
+    sink.begin(name, footprint, haveBody);
+    if (haveBody)
+        sink.body(getModelCenter(footprint), footprint.body.size);
+    sink.end();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Footprint.hpp"
+#include "FootprintSink.hpp"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+struct CachedPadArray;
+
+// cache of generated pad arrays, shared by the layout passes of a generator so that footprints with the same pad array
+// at the same position reuse the pads and their formatted output. When the cache is full, the least recently used pad
+// array is evicted
+class PadArrayCache {
+public:
+    explicit PadArrayCache(size_t capacity = 4096) : capacity(capacity) {}
+
+    // get a pad array and mark it as recently used, returns nullptr if it is not cached
+    std::shared_ptr<const CachedPadArray> get(const std::string &key);
+
+    // add a pad array, returns the cached pad array if another thread added the same pad array first
+    std::shared_ptr<const CachedPadArray> add(const std::string &key, std::shared_ptr<const CachedPadArray> padArray);
+
+protected:
+    // pad arrays, most recently used first
+    using List = std::list<std::pair<std::string, std::shared_ptr<const CachedPadArray>>>;
+
+    size_t capacity;
+    std::mutex mutex;
+    List list;
+
+    // keys point into the list
+    std::unordered_map<std::string_view, List::iterator> map;
+};
+
+// lay out a footprint (pads, silkscreen, fabrication layer, courtyard and body) in a single pass and feed the
+// geometry to a sink. Pad arrays are generated only once for all footprints that use the same pad array cache
+void layoutFootprint(const std::string &name, const Footprint &footprint, FootprintSink &sink,
+    PadArrayCache *padArrays = nullptr);
+
+// feed only the body of a footprint to a sink, for sinks that write 3D models
+void layoutModel(const std::string &name, const Footprint &footprint, FootprintSink &sink);
@@ -1,1038 +1,473 @@
-#include "clipper2.hpp"
-#include "double3.hpp"
+#include "expandVariant.hpp"
 #include "Footprint.hpp"
-#include "generateStep.hpp"
-#include "generateVrml.hpp"
-#include <nlohmann/json.hpp>
+#include "FootprintSink.hpp"
+#include "importKicad.hpp"
+#include "layoutFootprint.hpp"
+#include "LibraryCache.hpp"
+#include "LibraryIndex.hpp"
+#include "MemoryStats.hpp"
+#include "Output.hpp"
+#include "readJson.hpp"
+#include "Reporter.hpp"
+#include "Scheduler.hpp"
+#include "Shard.hpp"
+#include "writeJson.hpp"
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
-#include <fstream>
 #include <filesystem>
-#include <set>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 
-using json = nlohmann::json;
 namespace fs = std::filesystem;
 
 
-void read(json &j, const std::string &key, std::string &value) {
-    value = j.value(key, value);
-}
-
-void read(json &j, const std::string &key, bool &value) {
-    value = j.value(key, value);
-}
-
-void read(json &j, const std::string &key, int &value) {
-    value = j.value(key, value);
-}
-
-void read(json &j, const std::string &key, double &value) {
-    value = j.value(key, value);
-}
-
-void readRelaxed(json &j, const std::string &key, double2 &value) {
-    if (j.contains(key)) {
-        json jv = j.at(key);
-        if (jv.is_number()) {
-            value.x = jv.get<double>();
-            value.y = value.x;
-        } else if (jv.is_array()) {
-            value.x = jv.at(0).get<double>();
-            if (jv.size() >= 2)
-                value.y = jv.at(1).get<double>();
-            else
-                value.y = value.x;
-        }
-    }
-}
-
-void read(json &j, const std::string &key, double2 &value) {
-    if (j.contains(key)) {
-        json jv = j.at(key);
-        value.x = jv.at(0).get<double>();
-        value.y = jv.at(1).get<double>();
-    }
-}
-
-void read(json &j, const std::string &key, double3 &value) {
-    if (j.contains(key)) {
-        json jv = j.at(key);
-        value.x = jv.at(0).get<double>();
-        value.y = jv.at(1).get<double>();
-        value.z = jv.at(2).get<double>();
+// generates footprints on worker threads. Each output of a footprint is a separate task so that the cheap kicad files
+// are written early while the expensive step files keep the remaining workers busy. The number of pending tasks is
+// bounded, so reading can't run far ahead of generation
+class Generator {
+public:
+    Generator(const fs::path &dir, Output &output, const SinkOptions &options, const Shard &shard, int threadCount)
+        : dir(dir), output(output), options(options), shard(shard), maxQueued(threadCount * 16), scheduler(threadCount)
+    {
+        // each worker has its own sinks
+        for (int i = 0; i < threadCount; ++i)
+            this->workers.push_back(std::make_unique<Worker>(dir, output, options));
     }
-}
-
-
-void readPad(json &j, Footprint::Pad &pad) {
-    // type
-    std::string type = j.value("type", std::string());
-    if (type == "dual")
-        pad.type = Footprint::Pad::Type::DUAL;
-    else if (type == "quad")
-        pad.type = Footprint::Pad::Type::QUAD;
-    else if (type == "grid")
-        pad.type = Footprint::Pad::Type::GRID;
-
-    // position
-    read(j, "position", pad.position);
-
-    // distance
-    readRelaxed(j, "distance", pad.distance);
-
-    // pitch
-    read(j, "pitch", pad.pitch);
-
-    // shift
-    read(j, "shift", pad.shift);
-
-    // size
-    readRelaxed(j, "size", pad.size);
 
-    // offset
-    readRelaxed(j, "offset", pad.offset);
-
-    // shape
-    read(j, "shape", pad.shape);
-
-    // drill size
-    readRelaxed(j, "drillSize", pad.drillSize);
-
-    // drill offset
-    readRelaxed(j, "drillOffset", pad.drillOffset);
-
-    // clearance
-    read(j, "clearance", pad.clearance);
-
-    // solder mask margin
-    read(j, "maskMargin", pad.maskMargin);
-
-    // layers
-    read(j, "back", pad.back);
-    read(j, "jumper", pad.jumper);
-    if (pad.jumper) {
-        // set defaults for jumper
-        pad.mask = false;
-        pad.paste = false;
+    ~Generator() {
+        finish();
     }
-    read(j, "mask", pad.mask);
-    read(j, "paste", pad.paste);
-
-    // pad count
-    read(j, "count", pad.count);
-
-    // mirror
-    read(j, "mirror", pad.mirror);
 
-    // numbering
-    std::string numbering = j.value("numbering", std::string());
-    if (numbering == "columns")
-        pad.numbering = Footprint::Pad::Numbering::COLUMNS;
-    else if (numbering == "rows")
-        pad.numbering = Footprint::Pad::Numbering::ROWS;
-
-    // double
-    read(j, "double", pad.double_);
-
-    // first pad number
-    read(j, "number", pad.number);
-
-    // pad number increment
-    read(j, "increment", pad.increment);
-
-    // pad names
-    if (j.contains("names")) {
-        for (auto name : j.at("names")) {
-            pad.names.push_back(name.get<std::string>());
+    // add a footprint, blocks while too many tasks are pending. Variants of a footprint family are expanded by the
+    // workers
+    void add(const std::string &name, std::shared_ptr<const Footprint> footprint) {
+        // check if footprint is a template
+        if (footprint->template_)
+            return;
+        if (footprint->variants.empty()) {
+            if (this->shard.contains(name))
+                addUnit(name, footprint, -1);
+        } else {
+            int count = footprint->variants.size();
+            for (int i = 0; i < count; ++i) {
+                if (this->shard.contains(name, i))
+                    addUnit(name, footprint, i);
+            }
         }
     }
-}
 
-void readLine(json &j, Footprint::Line &line) {
-    // layer
-    read(j, "layer", line.layer);
-
-    // width
-    read(j, "width", line.width);
-
-    // list of points
-    if (j.contains("points")) {
-        auto jp = j.at("points");
-
-        int size = jp.size();
-        for (int i = 0; i < size - 1; i += 2) {
-            double x = jp.at(i + 0).get<double>();
-            double y = jp.at(i + 1).get<double>();
-            line.points.emplace_back(x, y);
+    // number of footprints that add() generates for a footprint in this shard
+    size_t getCount(const std::string &name, const Footprint &footprint) const {
+        if (footprint.template_)
+            return 0;
+        if (footprint.variants.empty())
+            return this->shard.contains(name) ? 1 : 0;
+        size_t count = 0;
+        int variantCount = footprint.variants.size();
+        for (int i = 0; i < variantCount; ++i) {
+            if (this->shard.contains(name, i))
+                ++count;
         }
-    }
-}
-
-void readCircle(json &j, Footprint::Circle &circle) {
-    // layer
-    read(j, "layer", circle.layer);
-
-    // fill
-    read(j, "fill", circle.fill);
-    if (circle.fill) {
-        // set default width for filled circle
-        circle.width = 0;
+        return count;
     }
 
-    // width
-    read(j, "width", circle.width);
-
-
-    // center
-    read(j, "center", circle.center);
-
-    // diameter or radius
-    double diameter;
-    read(j, "diameter", diameter);
-    circle.radius = diameter * 0.5;
-    read(j, "radius", circle.radius);
-}
-
-
-void readFootprint(json &j, std::map<std::string, Footprint> &footprints, Footprint &footprint) {
-    // inherit existing footprint
-    std::string inherit = j.value("inherit", std::string());
-    if (footprints.contains(inherit)) {
-        footprint = footprints[inherit];
-        footprint.template_ = false;
-    }
-
-    // template
-    read(j, "template", footprint.template_);
-
-    // description
-    read(j, "description", footprint.description);
-
-    // body
-    if (j.contains("body")) {
-        auto body = j.at("body");
-        read(body, "size", footprint.body.size);
-        read(body, "offset", footprint.body.offset);
+    // wait until all footprints are generated
+    void finish() {
+        this->scheduler.finish();
     }
 
-    // silkscreen
-    read(j, "silkscreen", footprint.silkscreen);
-    readRelaxed(j, "silkscreenAdd", footprint.silkscreenAdd);
-
-    // courtyard
-    read(j, "courtyard", footprint.courtyard);
-    readRelaxed(j, "courtyardAdd", footprint.courtyardAdd);
-
-    // global position, applies to everything
-    read(j, "position", footprint.position);
+    // names of the generated footprints
+    const std::vector<std::string> &getNames() const {return this->names;}
 
-    // offset, applies only to body
-    //read(j, "offset", footprint.offset);
+protected:
+    // expected cost of the outputs in arbitrary units, step export is by far the slowest
+    static constexpr double layoutCost = 1;
+    static constexpr double padCost = 0.05;
+    static constexpr double vrmlCost = 2;
+    static constexpr double tessellatedVrmlCost = 10;
+    static constexpr double stepCost = 50;
 
-    // orientation (position of pin 1 marker)
-    std::string orientation = j.value("orientation", std::string());
-    if (orientation == "top-left")
-        footprint.orientation = Footprint::Orientation::TOP_LEFT;
-    else if (orientation == "bottom-right")
-        footprint.orientation = Footprint::Orientation::BOTTOM_RIGHT;
-    else if (orientation == "top-right")
-        footprint.orientation = Footprint::Orientation::TOP_RIGHT;
+    // sinks of a worker thread
+    struct Worker {
+        SequencedOutput output;
 
-        // pads or pad arrays
-    if (j.contains("pads")) {
-        auto jp = j.at("pads");
-
-        int size = jp.size();
-        footprint.pads.resize(size);
-        for (int i = 0; i < size; ++i) {
-            // read pad or pad array
-            readPad(jp.at(i), footprint.pads[i]);
-        }
-    } else {
-        // no pads
-        footprint.pads.clear();
-    }
+        // kicad, svg and xml need the full layout
+        std::unique_ptr<SinkList> layoutSinks;
 
-    // lines or polylines
-    if (j.contains("lines")) {
-        auto jl = j.at("lines");
+        // 3D models only need the body
+        std::unique_ptr<FootprintSink> vrmlSink;
+        std::unique_ptr<FootprintSink> stepSink;
 
-        int count = jl.size();
-        footprint.lines.resize(count);
-        for (int i = 0; i < count; ++i) {
-            // read line or polyline
-            readLine(jl.at(i), footprint.lines[i]);
+        Worker(const fs::path &dir, Output &output, const SinkOptions &options) : output(output) {
+            SinkOptions layoutOptions = options;
+            layoutOptions.formats &= KICAD | SVG | XML;
+            this->layoutSinks = createSinks(layoutOptions, dir, this->output);
+            this->vrmlSink = createVrmlSink(dir, this->output, options);
+            this->stepSink = createStepSink(dir, this->output);
         }
-    }
-
-    // circles
-    if (j.contains("circles")) {
-        auto jc = j.at("circles");
-
-        int count = jc.size();
-        footprint.circles.resize(count);
-        for (int i = 0; i < count; ++i) {
-            // read circle
-            readCircle(jc.at(i), footprint.circles[i]);
+    };
+
+    // footprint to generate, either a single footprint or a variant of a footprint family
+    struct Unit {
+        std::string name;
+        std::shared_ptr<const Footprint> footprint;
+
+        // position in the library, the output may use it to keep the order of the files
+        int sequence;
+
+        // memory statistics of all output tasks
+        MemoryAccount memory;
+
+        // number of output tasks that are not yet done
+        std::atomic<int> remaining = 0;
+    };
+
+    void addUnit(const std::string &name, std::shared_ptr<const Footprint> footprint, int variant) {
+        this->scheduler.waitBelow(this->maxQueued);
+        auto unit = std::make_shared<Unit>();
+        unit->sequence = this->sequence++;
+        if (variant < 0) {
+            unit->name = name;
+            unit->footprint = std::move(footprint);
+            pushOutputs(unit);
+        } else {
+            // expanding the variant is a task the outputs depend on, it gets the cost of its outputs so that it
+            // starts early
+            double cost = getCost(*footprint);
+            this->scheduler.push({cost, [this, unit, name, footprint, variant](int worker) {
+                MemoryScope scope(MemoryStage::RESOLVE);
+                auto expanded = std::make_shared<Footprint>();
+                expandVariant(name, *footprint, variant, unit->name, *expanded);
+                unit->footprint = std::move(expanded);
+                pushOutputs(unit);
+            }});
         }
     }
 
-    // type
-    std::string type = j.value("type", std::string());
-    if (type == "through hole")
-        footprint.type = Footprint::Type::THROUGH_HOLE;
-    else if (type == "smd")
-        footprint.type = Footprint::Type::SMD;
-}
-
-void readJson(const fs::path &path, std::map<std::string, Footprint> &footprints) {
-    // read config
-    std::ifstream s(path.string());
-    if (s.is_open()) {
-        try {
-            json j = json::parse(s,
-                nullptr, // callback
-                true, // allow exceptions
-                true); // ignore comments
-
-            for (auto& [name, value] : j.items()) {
-                Footprint footprint;
-
-                try {
-                    readFootprint(value, footprints, footprint);
-                    footprints[name] = footprint;
-                } catch (std::exception &e) {
-                    // parsing the json file failed
-                    std::cerr << name << ": " << e.what() << std::endl;
-                }
-            }
-        } catch (std::exception &e) {
-            // parsing the json file failed
-            std::cerr << "json: " << e.what() << std::endl;
+    // total expected cost of the outputs of a footprint
+    double getCost(const Footprint &footprint) const {
+        int formats = this->options.formats;
+        bool haveBody = footprint.body.size.xy().positive();
+        double cost = 0;
+        if (formats & (KICAD | SVG | XML))
+            cost += getLayoutCost(footprint);
+        if (haveBody && (formats & VRML))
+            cost += this->options.usePlugin ? tessellatedVrmlCost : vrmlCost;
+        if (haveBody && (formats & STEP))
+            cost += stepCost;
+        return cost;
+    }
+
+    static double getLayoutCost(const Footprint &footprint) {
+        int padCount = 0;
+        for (auto &pad : footprint.pads)
+            padCount += pad.count;
+        return layoutCost + padCount * padCost;
+    }
+
+    // push a task for each output of a footprint
+    void pushOutputs(const std::shared_ptr<Unit> &unit) {
+        const Footprint &footprint = *unit->footprint;
+        int formats = this->options.formats;
+        bool haveBody = footprint.body.size.xy().positive();
+        bool layout = formats & (KICAD | SVG | XML);
+        bool vrml = haveBody && (formats & VRML);
+        bool step = haveBody && (formats & STEP);
+        unit->remaining = int(layout) + int(vrml) + int(step);
+        if (unit->remaining == 0) {
+            complete(*unit);
+            return;
         }
-    } else {
-        std::cerr << "error: could not open file " << path.string() << std::endl;
-    }
-}
-
-// define a pad
-void writePad(std::ostream &s, std::string_view name, double2 position, double2 size, double2 offset, double shape,
-    double2 drillSize, const Footprint::Pad &pad)
-{
-    bool hasPad = size.positive();
-    bool hasDrill = drillSize.positive();
-
-    // pad
-    if (hasPad) {
-        s << "  (pad \"" << name << "\" ";
-        s << (hasDrill ? "thru_hole" : "smd");
-    } else {
-        // only hole
-        s << "  (pad \"\" np_thru_hole";
-        shape = CIRCLE;
-        size = drillSize;
-    }
-
-    // shape
-    if (shape <= RECTANGLE)
-        s << " rect";
-    else if (shape >= CIRCLE)
-        if (size.x == size.y)
-            s << " circle";
-        else
-            s << " oval";
-    else if (shape == ROUNDRECT)
-        s << " roundrect";
-    else
-        s << " roundrect (roundrect_rratio " << shape << ")";
-
-    // position/size
-    s << " (at " << position << ") (size " << size << ")";
-
-    // drill
-    if (hasDrill) {
-        s << " (drill ";
-        if (drillSize.x == drillSize.y)
-            s << drillSize.x;
-        else
-            s << "oval " << drillSize;
-        if (!offset.zero())
-            s << " (offset " << offset << ")";
-        s << ")";
-    }
-
-    // margins
-    if (pad.clearance > 0)
-        s << " (clearance " << pad.clearance << ")";
-    if (pad.maskMargin != 0)
-        s << " (solder_mask_margin " << pad.maskMargin << ")";
-
-    // layers
-    s << " (layers";
-    if (hasDrill) {
-        // front and back
-        s << " \"*.Cu\"";
-        if (pad.mask)
-            s << " \"*.Mask\"";
-    } else if (!pad.back) {
-        // front
-        s << " \"F.Cu\"";
-        if (pad.mask)
-            s << " \"F.Mask\"";
-        if (pad.paste)
-            s << " \"F.Paste\"";
-    } else {
-        // back
-        s << " \"B.Cu\"";
-        if (pad.mask)
-            s << " \"B.Mask\"";
-        if (pad.paste)
-            s << " \"B.Paste\"";
-    }
-    s << ")";
-    if (hasPad && hasDrill)
-        s << " (remove_unused_layers) (keep_end_layers)";
-
-    s << ')' << std::endl;
-}
-
-// write a single line
-void writeLine(std::ostream &s, double2 p1, double2 p2, double width, std::string_view layer) {
-    s << "  (fp_line"
-        " (start " << p1 << ")"
-        " (end " << p2 << ")"
-        " (stroke (width " << width << ") (type solid))"
-        " (layer " << layer << ")"
-        ")" << std::endl;
-}
-
-// write line consisting of multiple segments
-void writeLine(std::ostream &s, double2 position, const Footprint::Line &line) {
-    int segmentCount = line.points.size() - 1;
-    for (int i = 0; i < segmentCount; ++i) {
-        auto p1 = position + line.points[i];
-        auto p2 = position + line.points[i + 1];
-
-        s << "  (fp_line"
-            " (start " << p1 << ")"
-            " (end " << p2 << ")"
-            " (stroke (width " << line.width << ") (type solid))"
-            " (layer \"" << line.layer << "\")"
-            ")" << std::endl;
-    }
-}
-
-// write circle
-void writeCircle(std::ostream &s, double2 position, const Footprint::Circle &circle) {
-    auto p1 = position + circle.center;
-    auto p2 = p1 - double2(circle.radius, 0);
-    s << "  (fp_circle"
-        " (center " << p1 << ")"
-        " (end " << p2 << ")"
-        " (stroke (width " << circle.width << ") (type default))"
-        " (fill " << (circle.fill ? "solid" : "none") << ")"
-        " (layer \"" << circle.layer << "\")"
-        ")" << std::endl;
-}
-
-//(fp_circle (center -3 -3) (end -1 -3)
-//    (stroke (width 0.1) (type default)) (fill none) (layer "Dwgs.User") (tstamp b059da20-dda9-4f2a-ae1a-8a4282f97b48))
-
-// draw a rectangle to the given layer
-void writeRectangle(std::ostream &s, double2 center, double2 size, double width, std::string_view layer) {
-    double w = size.x;
-    double h = size.y;
-
-    double x1 = center.x - w * 0.5;
-    double y1 = center.y - h * 0.5;
-    double x2 = center.x + w * 0.5;
-    double y2 = center.y + h * 0.5;
-    writeLine(s, {x1, y1}, {x2, y1}, width, layer);
-    writeLine(s, {x2, y1}, {x2, y2}, width, layer);
-    writeLine(s, {x2, y2}, {x1, y2}, width, layer);
-    writeLine(s, {x1, y2}, {x1, y1}, width, layer);
-}
-
-
-double2 orient(double x, double y, Footprint::Orientation o) {
-    switch (o) {
-    default: // BOTTOM_LEFT
-        return { x,  y};
-    case Footprint::Orientation::BOTTOM_RIGHT:
-        return { y, -x};
-    case Footprint::Orientation::TOP_LEFT:
-        return {-y,  x};
-    case Footprint::Orientation::TOP_RIGHT:
-        return {-x, -y};
-    }
-}
-
-
-constexpr double silkscreenWidth = 0.15;
-constexpr double silkscreenDistance = 0.1;
-constexpr double padClearance = 0.1;
-
-// add a rectangle pith pin 1 indicator to silscreen clipper
-void addSilkscreenRectangle(clipper2::Clipper64 &clipper, double2 center, double2 size, Footprint::Orientation o) {
-    double w = size.x;
-    double h = size.y;
-    if (o == Footprint::Orientation::BOTTOM_RIGHT || o == Footprint::Orientation::TOP_LEFT) {
-        // swap width and height
-        w = size.y;
-        h = size.x;
-    }
-
-    double x1 = - w * 0.5;
-    double y1 = + h * 0.5;
-    double x2 = + w * 0.5;
-    double y2 = - h * 0.5;
-
-    double d = 4 * silkscreenWidth;
-
-    double x = x1 + (x2 > x1 ? d : -d);
-    double y = y1 + (y2 > y1 ? d : -d);
-
-    {
-        clipper2::Paths64 paths;
-        clipper2::Path64 &path = paths.emplace_back();
-        path.push_back(toClipperPoint(center + orient(x, y1, o)));
-        path.push_back(toClipperPoint(center + orient(x2, y1, o)));
-        path.push_back(toClipperPoint(center + orient(x2, y2, o)));
-        path.push_back(toClipperPoint(center + orient(x1, y2, o)));
-        path.push_back(toClipperPoint(center + orient(x1, y, o)));
-        clipper.AddOpenSubject(paths);
-    }
-
-    // add pin1 indicator
-    {
-        clipper2::Paths64 paths;
-        clipper2::Path64 &path = paths.emplace_back();
-        double w = silkscreenWidth * 0.5;
-        path.push_back(toClipperPoint(center + orient(x1 - w, y1 - w, o)));
-        path.push_back(toClipperPoint(center + orient(x1 + w, y1 - w, o)));
-        path.push_back(toClipperPoint(center + orient(x1 + w, y1 + w, o)));
-        path.push_back(toClipperPoint(center + orient(x1 - w, y1 + w, o)));
-        clipper.AddSubject(paths);
-    }
-}
-
-inline void addSilkscreenPad(clipper2::Paths64 &paths, double2 center, double2 size, double2 drill) {
-    size.x = std::max(size.x, drill.x);
-    size.y = std::max(size.y, drill.y);
-    size.x += silkscreenWidth + padClearance * 2;
-    size.y += silkscreenWidth + padClearance * 2;
-    double x1 = center.x - size.x * 0.5;
-    double y1 = center.y + size.y * 0.5;
-    double x2 = center.x + size.x * 0.5;
-    double y2 = center.y - size.y * 0.5;
-
-    clipper2::Path64 path;
-    path.push_back(toClipperPoint({x1, y1}));
-    path.push_back(toClipperPoint({x2, y1}));
-    path.push_back(toClipperPoint({x2, y2}));
-    path.push_back(toClipperPoint({x1, y2}));
-    paths.push_back(path);
-}
-
-
-/*
-void silkscreenRectangle(std::ofstream &s, double2 center, double2 size) {
-    double x1 = center.x - size.x * 0.5;
-    double y1 = center.y + size.y * 0.5;
-    double x2 = center.x + size.x * 0.5;
-    double y2 = center.y - size.y * 0.5;
-
-    double d = 4 * silkscreenWidth;
-    double x = x1 + (x2 > x1 ? d : -d);
-    double y = y1 + (y2 > y1 ? d : -d);
-
-    // pin 1 marking
-    line(s, {x1, y1}, {x1, y1}, silkscreenWidth * 2, "F.SilkS");
-
-    // remaining rectangle
-    line(s, {x, y1}, {x2, y1}, silkscreenWidth, "F.SilkS");
-    line(s, {x2, y1}, {x2, y2}, silkscreenWidth, "F.SilkS");
-    line(s, {x2, y2}, {x1, y2}, silkscreenWidth, "F.SilkS");
-    line(s, {x1, y2}, {x1, y}, silkscreenWidth, "F.SilkS");
-}*/
-
-void writeSilkscreenPaths(std::ostream &s, const clipper2::Paths64 &paths, int open = 0) {
-    for (auto &path : paths) {
-        int count = path.size();
-        for (int i = 0; i < count - open; ++i) {
-            auto p1 = toPoint(path[i]);
-            auto p2 = toPoint(path[(i + 1) % count]);
-            writeLine(s, p1, p2, silkscreenWidth, "F.SilkS");
+        unit->memory = MemoryAccount(unit->name);
+
+        if (layout) {
+            this->scheduler.push({getLayoutCost(footprint), [this, unit](int worker) {
+                auto &w = *this->workers[worker];
+                MemoryScope scope(MemoryStage::LAYOUT, unit->memory);
+                w.output.sequence = unit->sequence;
+                layoutFootprint(unit->name, *unit->footprint, *w.layoutSinks, &this->padArrays);
+                done(*unit);
+            }});
         }
-    }
-}
-
-constexpr double fabWidth = 0.15;
-constexpr double fabDistance = 0.2;
-
-void writeFabRectangle(std::ofstream &s, double2 center, double2 size, Footprint::Orientation o) {
-    double w = size.x;
-    double h = size.y;
-    if (o == Footprint::Orientation::BOTTOM_RIGHT || o == Footprint::Orientation::TOP_LEFT) {
-        // swap width and height
-        w = size.y;
-        h = size.x;
-    }
-
-    double x1 = - w * 0.5;
-    double y1 = + h * 0.5;
-    double x2 = + w * 0.5;
-    double y2 = - h * 0.5;
-
-    double d = std::min(std::abs(size.x), std::abs(size.y)) * 0.25;
-    double x = x1 + (x2 > x1 ? d : -d);
-    double y = y1 + (y2 > y1 ? d : -d);
-
-    writeLine(s, center + orient(x, y1, o), center + orient(x1, y, o), silkscreenWidth, "F.Fab");
-    writeLine(s, center + orient(x, y1, o), center + orient(x2, y1, o), silkscreenWidth, "F.Fab");
-    writeLine(s, center + orient(x2, y1, o), center + orient(x2, y2, o), silkscreenWidth, "F.Fab");
-    writeLine(s, center + orient(x2, y2, o), center + orient(x1, y2, o), silkscreenWidth, "F.Fab");
-    writeLine(s, center + orient(x1, y2, o), center + orient(x1, y, o), silkscreenWidth, "F.Fab");
-}
-
-void writeSingle(std::ofstream &s, const Footprint &footprint, const Footprint::Pad &pad, clipper2::Paths64 &clips) {
-    int count = pad.count;
-    bool hasPad = pad.size.positive();
-    bool hasDrill = pad.drillSize.positive();
-
-    // position of first pin
-    double2 position = footprint.position + pad.position;// + double2((pad.pitch * (count - 1)) * -0.5, 0);
-
-    // pitch
-    double2 pitch = {0, 0};
-
-    // offset of pad relative to drill
-    double2 padOffset = {0, 0};
-
-    double start = pad.pitch * (count - 1) * 0.5;
-
-    // adjust position/pitch depending on orientation
-    if (footprint.orientation == Footprint::Orientation::BOTTOM_LEFT) {
-        // pin 1 marker is bottom left
-        position += double2(-start, 0);
-
-        // advance in positive x direction (horizontal)
-        pitch.x = pad.pitch;
-    } else if (footprint.orientation == Footprint::Orientation::BOTTOM_RIGHT) {
-        // pin 1 marker is bottom right
-        position += double2(0, start);
-
-        // advance in negative y direction (vertical)
-        pitch.y = -pad.pitch;
-    } else if (footprint.orientation == Footprint::Orientation::TOP_LEFT) {
-        // pin 1 marker is top left
-        position += double2(0, -start);
-
-        // advance in positive y direction (vertical)
-        pitch.y = pad.pitch;
-    } else {
-        // pin 1 marker is top right
-        position += double2(start, 0);
-
-        // advance in negative x direction (horizontal)
-        pitch.x = -pad.pitch;
-    }
-
-    // adjust position/offset depending on drill
-    if (!hasDrill) {
-        position += pad.offset;
-    } else {
-        position += pad.drillOffset;
-        if (hasPad)
-            padOffset = pad.offset - pad.drillOffset;
-    }
-
-    // generate pins
-    for (int i = 0; i < count; ++i) {
-        int index = pad.mirror ? count - 1 - i : i;
-
-        int n = index;
-        if (pad.double_) {
-            // double pins
-            n /= 2;
+        if (vrml) {
+            double cost = this->options.usePlugin ? tessellatedVrmlCost : vrmlCost;
+            this->scheduler.push({cost, [this, unit](int worker) {
+                auto &w = *this->workers[worker];
+                MemoryScope scope(MemoryStage::VRML, unit->memory);
+                w.output.sequence = unit->sequence;
+                layoutModel(unit->name, *unit->footprint, *w.vrmlSink);
+                done(*unit);
+            }});
         }
-
-        if (pad.exists(n)) {
-            writePad(s, pad.getName(n), position, pad.size, padOffset, pad.shape, pad.drillSize, pad);
-            addSilkscreenPad(clips, position, pad.size, pad.drillSize);
+        if (step) {
+            this->scheduler.push({stepCost, [this, unit](int worker) {
+                auto &w = *this->workers[worker];
+                MemoryScope scope(MemoryStage::STEP, unit->memory);
+                w.output.sequence = unit->sequence;
+                layoutModel(unit->name, *unit->footprint, *w.stepSink);
+                done(*unit);
+            }});
         }
-        position += pitch;
     }
-}
-
-void writeDual(std::ofstream &s, const Footprint &footprint, const Footprint::Pad &pad,
-    clipper2::Paths64 &clips)
-{
-    int count = pad.count / 2;
-    bool hasPad = pad.size.positive();
-    bool hasDrill = pad.drillSize.positive();
-
-    double padDistance = pad.distance.x;
-
-    // center position  of first pin in each row (start with center)
-    double2 position = footprint.position + pad.position;
 
-    // shift
-    double shift = pad.shift;
-
-    // offset of pad relative to drill
-    double2 padOffset1 = {0, 0};
-    double2 padOffset2 = {0, 0};
-
-    double start1 = pad.pitch * (count - 1) * 0.5 + shift;
-    double start2 = pad.pitch * (count - 1) * 0.5 - shift;
-
-    // calc position/pitch depending on orientation
-    double2 position1 = position;
-    double2 position2 = position;
-    double2 pitch = {0, 0};
-    if (footprint.orientation == Footprint::Orientation::BOTTOM_LEFT) {
-        // pin 1 marker is bottom left
-        position1 += double2(-start1, padDistance * 0.5);
-        position2 += double2(-start2, padDistance * -0.5);
-
-        // advance in positive x direction (horizontal)
-        pitch.x = pad.pitch;
-    } else if (footprint.orientation == Footprint::Orientation::BOTTOM_RIGHT) {
-        // pin 1 marker is bottom right
-        position1 += double2(padDistance * 0.5, start1);
-        position2 += double2(padDistance * -0.5, start2);
-
-        // advance in negative y direction (vertical)
-        pitch.y = -pad.pitch;
-    } else if (footprint.orientation == Footprint::Orientation::TOP_LEFT) {
-        // pin 1 marker is top left
-        position1 += double2(padDistance * -0.5, -start1);
-        position2 += double2(padDistance * 0.5, -start2);
-
-        // advance in positive y direction (vertical)
-        pitch.y = pad.pitch;
-    } else {
-        // pin 1 marker is top right
-        position1 += double2(start1, padDistance * -0.5);
-        position2 += double2(start2, padDistance * 0.5);
-
-        // advance in negative x direction (horizontal)
-        pitch.x = -pad.pitch;
+    // an output task of a footprint is done
+    void done(Unit &unit) {
+        if (--unit.remaining == 0)
+            complete(unit);
     }
 
-    // adjust position/offset depending on drill
-    if (!hasDrill) {
-        position1 += pad.offset;
-        position2 -= pad.offset;
-    } else {
-        position1 += pad.drillOffset;
-        position2 -= pad.drillOffset;
-        if (hasPad) {
-            padOffset1 = pad.offset - pad.drillOffset;
-            padOffset2 = -padOffset1;
+    // all outputs of a footprint are done
+    void complete(Unit &unit) {
+        reportFootprint(unit.name);
+        {
+            std::lock_guard<std::mutex> lock(this->namesMutex);
+            this->names.push_back(unit.name);
         }
+        this->output.complete(unit.sequence);
     }
 
-    // generate pins
-    for (int i = 0; i < count; ++i) {
-        int index = pad.mirror ? count - 1 - i : i;
-
-        int n1, n2;
-        if (pad.numbering == Footprint::Pad::Numbering::CIRCULAR) {
-            // circular numbering
-            n1 = index;
-            n2 = pad.count - 1 - index;
-        } else if (pad.numbering == Footprint::Pad::Numbering::COLUMNS) {
-            // number by columns (zigzag)
-            n1 = index * 2;
-            n2 = index * 2 + 1;
-        } else {
-            // number by rows
-            n1 = index;
-            n2 = pad.count / 2 + index;
-        }
-        if (pad.double_) {
-            // double pins
-            n1 /= 2;
-            n2 /= 2;
-        }
-
-        // first row
-        if (pad.exists(n1)) {
-            writePad(s, pad.getName(n1), position1, pad.size, padOffset1, pad.shape, pad.drillSize, pad);
-            addSilkscreenPad(clips, position1, pad.size, pad.drillSize);
-        }
-
-        // second row
-        if (pad.exists(n2)) {
-            writePad(s, pad.getName(n2), position2, pad.size, padOffset2, pad.shape, pad.drillSize, pad);
-            addSilkscreenPad(clips, position2, pad.size, pad.drillSize);
-        }
-
-        // increment position
-        position1 += pitch;
-        position2 += pitch;
-    }
-}
+    fs::path dir;
+    Output &output;
+    SinkOptions options;
+    Shard shard;
+    size_t maxQueued;
+    int sequence = 0;
 
-double2 rot90(double2 p) {
-    return {p.y, p.x};
-}
+    std::vector<std::unique_ptr<Worker>> workers;
+    Scheduler scheduler;
 
-double2 swap(double2 p) {
-    return {p.y, p.x};
-}
+    // pad arrays shared by the workers
+    PadArrayCache padArrays;
 
-// write quad (e.g. QFP)
-void writeQuad(std::ofstream &s, double2 globalPosition, const Footprint::Pad &pad, clipper2::Paths64 &clips) {
-    int count = pad.count / 4;
-    bool hasPad = pad.size.positive();
-    bool hasDrill = pad.drillSize.positive();
+    std::mutex namesMutex;
+    std::vector<std::string> names;
+};
 
-    // position of first pin in each row
-    double2 position1 = globalPosition + pad.position + double2((pad.pitch * (count - 1)) * -0.5, pad.distance.x * 0.5);
-    double2 position2 = globalPosition + pad.position + double2(pad.distance.y * 0.5, (pad.pitch * (count - 1)) * 0.5);
-    double2 position3 = globalPosition + pad.position + double2((pad.pitch * (count - 1)) * 0.5, pad.distance.x * -0.5);
-    double2 position4 = globalPosition + pad.position + double2(pad.distance.y * -0.5, (pad.pitch * (count - 1)) * -0.5);
+int main(int argc, const char **argv) {
+    //Footprint footprint;
+    //footprint.body.size = {1, 1, 1};
+    //generateStep(".", "foo.step", footprint);
+    //return 0;
 
-    // offset of pad relative to drill
-    double2 padOffset1 = {0, 0};
-    double2 padOffset2 = {0, 0};
-    double2 padOffset3 = {0, 0};
-    double2 padOffset4 = {0, 0};
+    if (argc < 2)
+        return 1;
 
-    if (!hasDrill) {
-        position1 += pad.offset;
-        position2 += rot90(pad.offset);
-        position3 -= pad.offset;
-        position4 -= rot90(pad.offset);
-    } else {
-        position1 += pad.drillOffset;
-        position2 += rot90(pad.drillOffset);
-        position3 -= pad.drillOffset;
-        position4 -= rot90(pad.drillOffset);
-        if (hasPad) {
-            padOffset1 = pad.offset - pad.drillOffset;
-            padOffset2 = rot90(pad.offset - pad.drillOffset);
-            padOffset3 = -padOffset1;
-            padOffset4 = -padOffset3;
+    // import existing footprints: footprint-tool import <output.json> <.kicad_mod file or .pretty directory>...
+    if (std::string_view(argv[1]) == "import") {
+        if (argc < 4)
+            return 1;
+        std::map<std::string, Footprint> footprints;
+        for (int i = 3; i < argc; ++i) {
+            std::cout << "Import " << argv[i] << '\n';
+            importKicadLibrary(argv[i], footprints);
         }
-    }
-
-    double2 padSize24 = swap(pad.size);
 
-    // generate pins
-    for (int i = 0; i < count; ++i) {
-        int index = pad.mirror ? count - 1 - i : i;
-
-        int n1 = index;
-        int n2 = count + index;
-        int n3 = count * 2 + index;
-        int n4 = count * 3 + index;
-
-        if (pad.exists(n1)) {
-            writePad(s, pad.getName(n1), position1, pad.size, padOffset1, pad.shape, pad.drillSize, pad);
-            addSilkscreenPad(clips, position1, pad.size, pad.drillSize);
-        }
-        if (pad.exists(n2)) {
-            writePad(s, pad.getName(n2), position2, padSize24, padOffset2, pad.shape, swap(pad.drillSize), pad);
-            addSilkscreenPad(clips, position2, padSize24, pad.drillSize);
-        }
-        if (pad.exists(n3)) {
-            writePad(s, pad.getName(n3), position3, pad.size, padOffset3, pad.shape, pad.drillSize, pad);
-            addSilkscreenPad(clips, position3, pad.size, pad.drillSize);
-        }
-        if (pad.exists(n4)) {
-            writePad(s, pad.getName(n4), position4, padSize24, padOffset4, pad.shape, swap(pad.drillSize), pad);
-            addSilkscreenPad(clips, position4, padSize24, pad.drillSize);
+        // the imported footprints are written even if some files failed, but the errors are reflected in the exit code
+        bool success = writeJson(argv[2], footprints);
+        return success && getErrorCount() == 0 ? 0 : 1;
+    }
+
+    // convert a library between json, cbor and msgpack: footprint-tool convert <input> <output>
+    if (std::string_view(argv[1]) == "convert") {
+        if (argc < 4)
+            return 1;
+        return convertLibrary(argv[2], argv[3]) ? 0 : 1;
+    }
+
+    // merge manifests of shards: footprint-tool merge <output.manifest> <shard manifest>...
+    if (std::string_view(argv[1]) == "merge") {
+        if (argc < 4)
+            return 1;
+        std::vector<fs::path> manifests(argv + 3, argv + argc);
+        return mergeManifests(argv[2], manifests) ? 0 : 1;
+    }
+
+    // query the resolved library without generating anything: footprint-tool query <input.json> <filter>..., e.g.
+    // footprint-tool query lib.json pitch=0.5 "pins>64"
+    if (std::string_view(argv[1]) == "query") {
+        if (argc < 3)
+            return 1;
+        std::vector<LibraryIndex::Filter> filters;
+        for (int i = 3; i < argc; ++i) {
+            auto &filter = filters.emplace_back();
+            if (!LibraryIndex::parseFilter(argv[i], filter)) {
+                std::cerr << "error: invalid filter " << argv[i] << std::endl;
+                return 1;
+            }
         }
 
-        // increment position
-        position1.x += pad.pitch;
-        position2.y -= pad.pitch;
-        position3.x -= pad.pitch;
-        position4.y += pad.pitch;
+        // use the cache if it is up to date, but don't write it
+        fs::path path = argv[2];
+        fs::path cachePath = path;
+        cachePath += ".cache";
+        std::map<std::string, Footprint> footprints;
+        if (!fs::exists(cachePath) || !readCache(cachePath, hashFile(path), footprints))
+            readJson(path, footprints);
+
+        LibraryIndex index(footprints);
+        for (auto &name : index.query(filters))
+            std::cout << name << '\n';
+        return getErrorCount() > 0 ? 1 : 0;
+    }
+
+    // options
+    fs::path path;
+    bool cache = false;
+    bool stream = false;
+    bool memoryStats = false;
+    bool noStep = false;
+    bool tessellate = false;
+    fs::path tarPath;
+    fs::path logPath;
+    SinkOptions options;
+    Shard shard;
+    int threadCount = std::max(int(std::thread::hardware_concurrency()), 1);
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--cache") {
+            // use binary cache of the resolved footprints next to the input file
+            cache = true;
+        } else if (arg == "--stream") {
+            // generate each footprint as soon as it is read instead of reading the whole library first
+            stream = true;
+        } else if (arg == "--memory-stats") {
+            // print allocations and peak memory per stage and the footprints that use the most memory
+            memoryStats = true;
+        } else if (arg == "--no-step") {
+            // don't generate step files and don't load the step plugin unless --tessellate is given
+            noStep = true;
+        } else if (arg == "--tessellate") {
+            // tessellate vrml models with the step plugin also if step files are disabled
+            tessellate = true;
+        } else if (arg == "--no-plugin") {
+            // don't load the step plugin and OpenCASCADE, no step files and vrml models are built-in boxes
+            options.formats &= ~STEP;
+            options.usePlugin = false;
+        } else if (arg == "--svg") {
+            // also write svg previews
+            options.formats |= SVG;
+        } else if (arg == "--xml") {
+            // also write land patterns as xml in IPC-7351 style
+            options.formats |= XML;
+        } else if (arg == "--wrz") {
+            // write vrml models compressed with gzip
+            options.compressVrml = true;
+        } else if (arg == "--deflection" && i + 1 < argc) {
+            // maximum deviation of tessellated 3D models in mm, trades fidelity against file size
+            options.deflection = std::atof(argv[++i]);
+        } else if (arg == "--tar" && i + 1 < argc) {
+            // write all files into one tar archive, "-" for stdout
+            tarPath = argv[++i];
+        } else if (arg == "--log" && i + 1 < argc) {
+            // write all progress events, warnings and errors as json lines
+            logPath = argv[++i];
+        } else if (arg == "--shard" && i + 1 < argc) {
+            // generate only a deterministic subset of the footprints and write a manifest, e.g. --shard 0/4
+            if (!shard.parse(argv[++i])) {
+                std::cerr << "error: invalid shard " << argv[i] << ", expected index/count" << std::endl;
+                return 1;
+            }
+        } else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+            // number of threads that generate footprints
+            threadCount = std::max(std::atoi(argv[++i]), 1);
+        } else {
+            path = arg;
+        }
     }
-
-}
-
-// generate grid (e.g. BGA)
-void writeGrid(std::ofstream &s, double2 globalPosition, const Footprint::Pad &pad, clipper2::Paths64 &clips) {
-
-}
-
-bool allowSoldermaskBridges(const Footprint &footprint) {
-    // return true if pads are a jumper
-    for (auto &pad : footprint.pads) {
-        if (pad.jumper)
-            return true;
+    if (path.empty())
+        return 1;
+    if (noStep) {
+        // without step files the plugin is only loaded on request, so that startup stays fast
+        options.formats &= ~STEP;
+        if (!tessellate)
+            options.usePlugin = false;
     }
-    return false;
-}
-
-bool generateFootprint(const fs::path &path, const std::string &name, const Footprint &footprint) {
-    double2 position = footprint.position + footprint.body.offset.xy();
-
-    auto bodySize =  footprint.body.size.xy();
-    bool haveBody = bodySize.positive();
-
-    double2 silkscreenSize = bodySize + footprint.silkscreenAdd;
-    bool haveSilkscreen = footprint.silkscreen && silkscreenSize.positive();
-
-    double2 courtyardSize = bodySize + footprint.courtyardAdd;
-    bool haveCourtyard = footprint.courtyard && courtyardSize.positive();
-
-    double2 refPosition = {0, 0};
-    double2 valuePosition = {0, 0};
-    double maskMargin = 0;
-    double pasteMargin = 0;
 
+    // files are written in the background
+    std::unique_ptr<Output> output;
+    if (tarPath.empty()) {
+        output = createFileOutput();
+    } else {
+        output = createTarOutput(tarPath, path.parent_path());
+        if (output == nullptr)
+            return 1;
 
-    // apply mirror to size so that pin1 marker is placed at the right position
-    if (!footprint.pads.empty() && footprint.pads.front().mirror) {
-        bodySize.x *= -1;
-        silkscreenSize.x *= -1;
+        // the archive goes to stdout, so messages go to stderr
+        if (tarPath == "-")
+            std::cout.rdbuf(std::cerr.rdbuf());
     }
 
-
-    std::ofstream s((path / (name + ".kicad_mod")).string());
-
-    // header
-    s << "(module " << name << " (layer F.Cu) (tedit 5EC043C1)" << std::endl;
-
-    // description
-    s << "  (descr \"" << footprint.description << "\")" << std::endl;
-
-    // attributes
-    s << "  (attr";
-    s << (footprint.getType() == Footprint::Type::THROUGH_HOLE ? " through_hole" : " smd");
-    if (allowSoldermaskBridges(footprint))
-        s << " allow_soldermask_bridges";
-    s  << ')' << std::endl;
-
-    // 3D model
-    if (haveBody)
-        s << "  (model \"" << name << ".wrl\" (at (xyz 0 0 0)) (scale (xyz 1 1 1)) (rotate (xyz 0 0 0)))" << std::endl;
-
-    // reference
-    s << "  (fp_text reference REF** (at " << refPosition << ") (layer F.SilkS) (effects (font (size 1 1) (thickness 0.15))))" << std::endl;
-
-    // value
-    s << "  (fp_text value " << name << " (at " << valuePosition << ") (layer F.Fab) (effects (font (size 1 1) (thickness 0.15))))" << std::endl;
-
-    // margins
-    s << "  (solder_mask_margin " << maskMargin << ")" << std::endl;
-    s << "  (solder_paste_margin " << pasteMargin << ")" << std::endl;
-
-    // clipper for silkscreen
-    clipper2::Clipper64 clipper;
-    clipper2::Paths64 clips; // shapes that clip away the silkscreen, e.g. pads
-
-    // body
-    if (haveBody) {
-        //double2 silkscreenSize = bodySize + footprint.margin * 2.0;
-
-        // apply mirror to size so that pin1 marker is placed at the rigt position
-        //if (!footprint.pads.empty() && footprint.pads.front().mirror) {
-        //    bodySize.x *= -1;
-        //    silkscreenSize.x *= -1;
-       // }
-
-
-        // fabrication layer
-        writeFabRectangle(s, position, bodySize, footprint.orientation);
-
-        // add silkscreen rectangle
-        //if (footprint.silkscreen) {
-            //addSilkscreenRectangle(clipper, position, silkscreenSize);
-        //}
+    // a shard records the written files for its manifest
+    ManifestOutput *manifestOutput = nullptr;
+    if (shard.count > 1) {
+        auto o = std::make_unique<ManifestOutput>(std::move(output), path.parent_path());
+        manifestOutput = o.get();
+        output = std::move(o);
     }
 
-    if (haveSilkscreen)
-        addSilkscreenRectangle(clipper, position, silkscreenSize, footprint.orientation);
+    // progress and diagnostics of all threads are reported in the background
+    if (!startReporter(logPath))
+        return 1;
 
-    // courtyard
-    if (haveCourtyard)
-        writeRectangle(s, position, courtyardSize, 0.05, "F.CrtYd");
+    // footprints are generated in parallel
+    Generator generator(path.parent_path(), *output, options, shard, threadCount);
 
-    // pads
-    for (auto &pad : footprint.pads) {
-        switch (pad.type) {
-        case Footprint::Pad::Type::SINGLE:
-            writeSingle(s, footprint, pad, clips);
-            break;
-        case Footprint::Pad::Type::DUAL:
-            writeDual(s, footprint, pad, clips);
-            break;
-        case Footprint::Pad::Type::QUAD:
-            writeQuad(s, footprint.position, pad, clips);
-            break;
-        case Footprint::Pad::Type::GRID:
-            writeGrid(s, footprint.position, pad, clips);
-            break;
+    // read footprints
+    if (stream) {
+        std::cout << "Read " << path << '\n';
+        streamJson(path, [&generator](const std::string &name, Footprint &&footprint) {
+            generator.add(name, std::make_shared<const Footprint>(std::move(footprint)));
+        });
+    } else {
+        std::map<std::string, Footprint> footprints;
+        if (cache) {
+            MemoryScope scope(MemoryStage::PARSE);
+            fs::path cachePath = path;
+            cachePath += ".cache";
+            uint64_t hash = hashFile(path);
+            if (readCache(cachePath, hash, footprints)) {
+                std::cout << "Read " << cachePath << '\n';
+            } else {
+                std::cout << "Read " << path << '\n';
+                size_t errorCount = getErrorCount();
+                readJson(path, footprints);
+
+                // a library with errors is not cached, otherwise the next run would miss the errors
+                if (getErrorCount() == errorCount)
+                    writeCache(cachePath, hash, footprints);
+            }
+        } else {
+            std::cout << "Read " << path << '\n';
+            readJson(path, footprints);
         }
+        size_t total = 0;
+        for (auto &[name, footprint] : footprints)
+            total += generator.getCount(name, footprint);
+        setReportTotal(total);
+        for (auto &[name, footprint] : footprints)
+            generator.add(name, std::make_shared<const Footprint>(std::move(footprint)));
     }
+    generator.finish();
 
-    // lines
-    for (auto &line : footprint.lines) {
-        writeLine(s, footprint.position, line);
-    }
-
-    // circles
-    for (auto &circle : footprint.circles) {
-        writeCircle(s, footprint.position, circle);
-    }
+    // wait until all files are written
+    bool success = output->finish();
+    stopReporter();
 
-    // silkscreen
-    if (haveSilkscreen) {
-        clipper.AddClip(clips);
+    // errors while reading or generating, e.g. invalid json or a footprint that could not be resolved
+    if (getErrorCount() > 0)
+        success = false;
 
-        // subtract pads from silkscreen
-        clipper2::Paths64 closedPahts;
-        clipper2::Paths64 openPaths;
-        clipper.Execute(clipper2::ClipType::Difference, clipper2::FillRule::NonZero, closedPahts, openPaths);
-        writeSilkscreenPaths(s, closedPahts);
-        writeSilkscreenPaths(s, openPaths, 1);
+    // write manifest of shard, inherit was resolved against all footprints
+    if (manifestOutput != nullptr) {
+        success &= writeManifest(shard.getManifestPath(path), shard, hashFile(path), generator.getNames(),
+            manifestOutput->getFiles(), tarPath);
     }
 
-    // footer
-    s << ")" << std::endl;
-
-    s.close();
-
-    // return true when vrml should be generated
-    return haveBody;
-}
-
-int main(int argc, const char **argv) {
-    //Footprint footprint;
-    //footprint.body.size = {1, 1, 1};
-    //generateStep(".", "foo.step", footprint);
-    //return 0;
-
-    if (argc < 2)
-        return 1;
-    fs::path path = argv[1];
-    //fs::path path = "footprints.json";
-    std::cout << "Read " << path << std::endl;
-
-    // read footprints
-    std::map<std::string, Footprint> footprints;
-    readJson(path, footprints);
-
-    // generate footprints
-    for (const auto &[name, footprint] : footprints) {
-        // check if footprint is a template
-        if (footprint.template_)
-            continue;
-        std::cout << name << std::endl;
-        auto dir = path.parent_path();
-        if (generateFootprint(dir, name, footprint)) {
-            generateVrml(dir, name, footprint);
-            generateStep(dir, name, footprint);
-        }
-    }
+    if (memoryStats)
+        printMemoryStats(std::cout);
 
-    return 0;
+    return success ? 0 : 1;
 }
@@ -0,0 +1,13 @@
+#include "makeBody.hpp"
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <gp_Pnt.hxx>
+
+
+TopoDS_Shape makeBody(double3 center, double3 size) {
+    gp_Pnt p1(center.x - size.x * 0.5, center.y - size.y * 0.5, center.z);
+    gp_Pnt p2(center.x + size.x * 0.5, center.y + size.y * 0.5, center.z + size.z);
+
+    // create quader
+    BRepPrimAPI_MakeBox boxMaker(p1, p2);
+    return boxMaker.Solid();
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "double3.hpp"
+#include <TopoDS_Shape.hxx>
+
+
+// create the body of a footprint as OpenCASCADE shape, center is at the bottom of the body in 3D coordinates (y up).
+// This is the only description of the body geometry, step export and vrml tessellation both use it
+TopoDS_Shape makeBody(double3 center, double3 size);
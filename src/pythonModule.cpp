@@ -0,0 +1,300 @@
+#include "expandVariant.hpp"
+#include "Footprint.hpp"
+#include "FootprintSink.hpp"
+#include "layoutFootprint.hpp"
+#include "Output.hpp"
+#include "readJson.hpp"
+#include "Reporter.hpp"
+#include "writeJson.hpp"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl_bind.h>
+#include <sstream>
+
+
+namespace py = pybind11;
+
+using Pad = Footprint::Pad;
+using Land = Footprint::Land;
+using Line = Footprint::Line;
+using Circle = Footprint::Circle;
+
+// lists of the footprint are bound as references so that they can be modified in place, e.g. fp.pads[0].count = 4
+PYBIND11_MAKE_OPAQUE(std::vector<Pad>)
+PYBIND11_MAKE_OPAQUE(std::vector<Line>)
+PYBIND11_MAKE_OPAQUE(std::vector<Circle>)
+PYBIND11_MAKE_OPAQUE(std::vector<std::string>)
+
+
+// vectors are tuples in python
+static std::tuple<double, double> toTuple(double2 v) {
+    return {v.x, v.y};
+}
+
+static std::tuple<double, double, double> toTuple(double3 v) {
+    return {v.x, v.y, v.z};
+}
+
+static double2 toDouble2(std::tuple<double, double> t) {
+    return {std::get<0>(t), std::get<1>(t)};
+}
+
+static double3 toDouble3(std::tuple<double, double, double> t) {
+    return {std::get<0>(t), std::get<1>(t), std::get<2>(t)};
+}
+
+// define a property of type double2 or double3 as tuple
+template <typename Class>
+void defVector(py::class_<Class> &c, const char *name, double2 Class::*member) {
+    c.def_property(name,
+        [member](const Class &o) {return toTuple(o.*member);},
+        [member](Class &o, std::tuple<double, double> t) {o.*member = toDouble2(t);});
+}
+
+template <typename Class>
+void defVector(py::class_<Class> &c, const char *name, double3 Class::*member) {
+    c.def_property(name,
+        [member](const Class &o) {return toTuple(o.*member);},
+        [member](Class &o, std::tuple<double, double, double> t) {o.*member = toDouble3(t);});
+}
+
+// bind a list type that can be assigned from a python list
+template <typename Vector>
+void bindList(py::module_ &m, const char *name) {
+    py::bind_vector<Vector>(m, name);
+    py::implicitly_convertible<py::list, Vector>();
+}
+
+// convert footprints to a python dictionary, the GIL must be held
+static py::dict toDict(std::map<std::string, Footprint> &&footprints) {
+    py::dict result;
+    for (auto &[name, footprint] : footprints)
+        result[py::str(name)] = py::cast(std::move(footprint));
+    return result;
+}
+
+// read footprints, errors are raised as exception
+template <typename Read>
+static py::dict load(Read read) {
+    std::map<std::string, Footprint> footprints;
+    std::string error;
+    {
+        py::gil_scoped_release release;
+        ErrorCapture errors;
+        read(footprints);
+        error = errors.getMessage();
+    }
+    if (!error.empty())
+        throw py::value_error(error);
+    return toDict(std::move(footprints));
+}
+
+// generate the files of a footprint or of all variants of a footprint family in memory
+static py::dict generate(const std::string &name, const Footprint &footprint, bool kicad, bool vrml, bool step,
+    bool svg, bool xml, bool wrz, double deflection)
+{
+    SinkOptions options;
+    options.formats = (kicad ? KICAD : 0) | (vrml ? VRML : 0) | (step ? STEP : 0) | (svg ? SVG : 0) | (xml ? XML : 0);
+    options.compressVrml = wrz;
+    options.deflection = deflection;
+
+    std::map<std::string, std::string> files;
+    {
+        // python threads can generate in parallel
+        py::gil_scoped_release release;
+        MemoryOutput output;
+        auto sinks = createSinks(options, {}, output);
+
+        // variants of a family share their pad arrays
+        PadArrayCache padArrays;
+        if (footprint.variants.empty()) {
+            layoutFootprint(name, footprint, *sinks, &padArrays);
+        } else {
+            std::string variantName;
+            Footprint variant;
+            int count = footprint.variants.size();
+            for (int i = 0; i < count; ++i) {
+                expandVariant(name, footprint, i, variantName, variant);
+                layoutFootprint(variantName, variant, *sinks, &padArrays);
+            }
+        }
+        files = output.take();
+    }
+
+    py::dict result;
+    for (auto &[path, data] : files)
+        result[py::str(path)] = py::bytes(data);
+    return result;
+}
+
+PYBIND11_MODULE(footprint_tool, m) {
+    m.doc() = "Generate KiCad footprints, vrml and step models in memory";
+
+    m.attr("RECTANGLE") = RECTANGLE;
+    m.attr("ROUNDRECT") = ROUNDRECT;
+    m.attr("ROUNDRECT10") = ROUNDRECT10;
+    m.attr("ROUNDRECT5") = ROUNDRECT5;
+    m.attr("CIRCLE") = CIRCLE;
+
+    bindList<std::vector<std::string>>(m, "NameList");
+
+    py::class_<Footprint> footprint(m, "Footprint");
+
+    py::enum_<Footprint::Type>(footprint, "Type")
+        .value("DETECT", Footprint::Type::DETECT)
+        .value("THROUGH_HOLE", Footprint::Type::THROUGH_HOLE)
+        .value("SMD", Footprint::Type::SMD);
+
+    py::enum_<Footprint::Orientation>(footprint, "Orientation")
+        .value("BOTTOM_LEFT", Footprint::Orientation::BOTTOM_LEFT)
+        .value("BOTTOM_RIGHT", Footprint::Orientation::BOTTOM_RIGHT)
+        .value("TOP_LEFT", Footprint::Orientation::TOP_LEFT)
+        .value("TOP_RIGHT", Footprint::Orientation::TOP_RIGHT);
+
+    py::enum_<Footprint::Density>(footprint, "Density")
+        .value("MOST", Footprint::Density::MOST)
+        .value("NOMINAL", Footprint::Density::NOMINAL)
+        .value("LEAST", Footprint::Density::LEAST);
+
+    py::class_<Land> land(footprint, "Land");
+
+    py::enum_<Land::Lead>(land, "Lead")
+        .value("NONE", Land::Lead::NONE)
+        .value("GULLWING", Land::Lead::GULLWING)
+        .value("JLEAD", Land::Lead::JLEAD)
+        .value("CHIP", Land::Lead::CHIP)
+        .value("FLAT", Land::Lead::FLAT);
+
+    land
+        .def(py::init<>())
+        .def_readwrite("lead", &Land::lead);
+    defVector(land, "span", &Land::span);
+    defVector(land, "terminal", &Land::terminal);
+    defVector(land, "width", &Land::width);
+
+    py::class_<Line> line(footprint, "Line");
+    line
+        .def(py::init<>())
+        .def_readwrite("layer", &Line::layer)
+        .def_readwrite("width", &Line::width)
+        .def_property("points",
+            [](const Line &l) {
+                // tuple of points, assign a new list to change the points
+                py::tuple points(l.points.size());
+                for (size_t i = 0; i < l.points.size(); ++i)
+                    points[i] = py::cast(toTuple(l.points[i]));
+                return points;
+            },
+            [](Line &l, const std::vector<std::tuple<double, double>> &points) {
+                l.points.clear();
+                for (auto &p : points)
+                    l.points.push_back(toDouble2(p));
+            });
+
+    py::class_<Circle> circle(footprint, "Circle");
+    circle
+        .def(py::init<>())
+        .def_readwrite("layer", &Circle::layer)
+        .def_readwrite("width", &Circle::width)
+        .def_readwrite("fill", &Circle::fill)
+        .def_readwrite("radius", &Circle::radius);
+    defVector(circle, "center", &Circle::center);
+
+    py::class_<Pad> pad(footprint, "Pad");
+
+    py::enum_<Pad::Type>(pad, "Type")
+        .value("SINGLE", Pad::Type::SINGLE)
+        .value("DUAL", Pad::Type::DUAL)
+        .value("QUAD", Pad::Type::QUAD)
+        .value("GRID", Pad::Type::GRID);
+
+    py::enum_<Pad::Numbering>(pad, "Numbering")
+        .value("CIRCULAR", Pad::Numbering::CIRCULAR)
+        .value("COLUMNS", Pad::Numbering::COLUMNS)
+        .value("ROWS", Pad::Numbering::ROWS);
+
+    pad
+        .def(py::init<>())
+        .def_readwrite("type", &Pad::type)
+        .def_readwrite("pitch", &Pad::pitch)
+        .def_readwrite("shift", &Pad::shift)
+        .def_readwrite("shape", &Pad::shape)
+        .def_readwrite("clearance", &Pad::clearance)
+        .def_readwrite("mask_margin", &Pad::maskMargin)
+        .def_readwrite("back", &Pad::back)
+        .def_readwrite("jumper", &Pad::jumper)
+        .def_readwrite("mask", &Pad::mask)
+        .def_readwrite("paste", &Pad::paste)
+        .def_readwrite("vertical", &Pad::vertical)
+        .def_readwrite("count", &Pad::count)
+        .def_readwrite("mirror", &Pad::mirror)
+        .def_readwrite("numbering", &Pad::numbering)
+        .def_readwrite("double", &Pad::double_)
+        .def_readwrite("number", &Pad::number)
+        .def_readwrite("increment", &Pad::increment)
+        .def_readwrite("names", &Pad::names)
+        .def_readwrite("land", &Pad::land);
+    defVector(pad, "position", &Pad::position);
+    defVector(pad, "distance", &Pad::distance);
+    defVector(pad, "size", &Pad::size);
+    defVector(pad, "offset", &Pad::offset);
+    defVector(pad, "drill_size", &Pad::drillSize);
+    defVector(pad, "drill_offset", &Pad::drillOffset);
+
+    bindList<std::vector<Pad>>(m, "PadList");
+    bindList<std::vector<Line>>(m, "LineList");
+    bindList<std::vector<Circle>>(m, "CircleList");
+
+    footprint
+        .def(py::init<>())
+        .def_readwrite("template", &Footprint::template_)
+        .def_readwrite("description", &Footprint::description)
+        .def_readonly("inherit", &Footprint::inherit)
+        .def_readwrite("type", &Footprint::type)
+        .def_property("body_size",
+            [](const Footprint &f) {return toTuple(f.body.size);},
+            [](Footprint &f, std::tuple<double, double, double> t) {f.body.size = toDouble3(t);})
+        .def_property("body_offset",
+            [](const Footprint &f) {return toTuple(f.body.offset);},
+            [](Footprint &f, std::tuple<double, double, double> t) {f.body.offset = toDouble3(t);})
+        .def_readwrite("silkscreen", &Footprint::silkscreen)
+        .def_readwrite("courtyard", &Footprint::courtyard)
+        .def_readwrite("orientation", &Footprint::orientation)
+        .def_readwrite("density", &Footprint::density)
+        .def_readwrite("pads", &Footprint::pads)
+        .def_readwrite("lines", &Footprint::lines)
+        .def_readwrite("circles", &Footprint::circles)
+        .def_readonly("parameters", &Footprint::parameters)
+        .def_property_readonly("variant_count", [](const Footprint &f) {return f.variants.size();})
+        .def("to_json", [](const Footprint &f) {
+            json j;
+            writeFootprint(j, f);
+            return j.dump();
+        }, "Convert to json in the format of the input files");
+    defVector(footprint, "position", &Footprint::position);
+    defVector(footprint, "silkscreen_add", &Footprint::silkscreenAdd);
+    defVector(footprint, "courtyard_add", &Footprint::courtyardAdd);
+
+    m.def("load", [](const std::string &path) {
+        return load([&path](std::map<std::string, Footprint> &footprints) {
+            readJson(fs::path(path), footprints);
+        });
+    }, py::arg("path"), "Read all footprints from a json, cbor or msgpack file, inherit and expressions are resolved. "
+        "Raises ValueError if the file can't be read or a footprint is invalid");
+
+    m.def("loads", [](const std::string &text) {
+        return load([&text](std::map<std::string, Footprint> &footprints) {
+            std::istringstream s(text);
+            readJson(s, footprints);
+        });
+    }, py::arg("text"), "Read all footprints from a json string, inherit and expressions are resolved. Raises "
+        "ValueError if the text is invalid");
+
+    m.def("generate", &generate,
+        py::arg("name"), py::arg("footprint"),
+        py::kw_only(),
+        py::arg("kicad") = true, py::arg("vrml") = true, py::arg("step") = false, py::arg("svg") = false,
+        py::arg("xml") = false, py::arg("wrz") = false, py::arg("deflection") = 0.01,
+        "Generate a footprint (or all variants of a footprint family) and return a dict of file name to bytes. The "
+        "GIL is released during generation");
+}
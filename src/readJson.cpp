@@ -0,0 +1,914 @@
+#include "readJson.hpp"
+#include "MappedFile.hpp"
+#include "MemoryStats.hpp"
+#include "Reporter.hpp"
+#include "solveLandPatterns.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+
+
+namespace {
+
+// state while reading a footprint, used for warnings and expressions
+struct Reader {
+    const std::string &name;
+    Footprint &footprint;
+
+    // index of the pad that is currently read or -1
+    int pad = -1;
+
+    void warning(std::string_view message) {
+        reportWarning(this->name, message);
+    }
+
+    // remove inherited binding of a field of the footprint that is given again
+    void unbind(std::string_view key) {
+        if (this->pad >= 0)
+            return;
+        auto &bindings = this->footprint.bindings;
+        bindings.erase(std::remove_if(bindings.begin(), bindings.end(),
+            [key](const Footprint::Binding &binding) {return binding.pad < 0 && binding.key == key;}), bindings.end());
+    }
+
+    // bind a field to an expression, it gets evaluated after all fields are read
+    void bind(std::string_view key, int component, const std::string &source) {
+        Footprint::Binding binding{this->pad, std::string(key), component, source};
+        std::string error;
+        if (!binding.expression.compile(source, error)) {
+            warning("invalid expression \"" + source + "\" for " + std::string(key) + ": " + error);
+            return;
+        }
+        this->footprint.bindings.push_back(std::move(binding));
+    }
+};
+
+// descriptor of a field of a json object
+template <typename T>
+struct Field {
+    std::string_view key;
+    void (*read)(Reader &r, const json &j, T &value);
+};
+
+// bit of a field in the bit set of read fields, fails to compile if the key is not in the table
+template <typename T, size_t N>
+constexpr uint64_t bit(const Field<T> (&fields)[N], std::string_view key) {
+    for (size_t i = 0; i < N; ++i) {
+        if (fields[i].key == key)
+            return uint64_t(1) << i;
+    }
+    throw std::logic_error("field not found");
+}
+
+// read all fields of a json object in one pass, returns a bit set of the fields that were read
+template <typename T, size_t N>
+uint64_t readFields(Reader &r, const json &j, const Field<T> (&fields)[N], T &value, std::string_view kind) {
+    static_assert(N <= 64);
+    if (!j.is_object())
+        throw std::runtime_error(std::string(kind) + " must be an object");
+    uint64_t read = 0;
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        const std::string &key = it.key();
+        size_t i = 0;
+        while (i < N && fields[i].key != key)
+            ++i;
+        if (i < N) {
+            fields[i].read(r, it.value(), value);
+            read |= uint64_t(1) << i;
+        } else {
+            r.warning("unknown key \"" + key + "\" in " + std::string(kind));
+        }
+    }
+    return read;
+}
+
+// name of an enum value
+template <typename E>
+struct Name {
+    std::string_view name;
+    E value;
+};
+
+template <typename E, size_t N>
+void readEnum(Reader &r, const json &j, const Name<E> (&names)[N], E &value, std::string_view key) {
+    auto &s = j.get_ref<const std::string &>();
+    for (auto &n : names) {
+        if (n.name == s) {
+            value = n.value;
+            return;
+        }
+    }
+    r.warning("unknown value \"" + s + "\" for " + std::string(key));
+}
+
+void read(const json &j, std::string &value) {
+    value = j.get<std::string>();
+}
+
+void read(const json &j, bool &value) {
+    value = j.get<bool>();
+}
+
+void read(const json &j, int &value) {
+    value = j.get<int>();
+}
+
+void read(const json &j, double &value) {
+    value = j.get<double>();
+}
+
+// read a number (applies to x and y) or an array of one or two numbers
+void readRelaxed(const json &j, double2 &value) {
+    if (j.is_number()) {
+        value.x = j.get<double>();
+        value.y = value.x;
+    } else if (j.is_array()) {
+        value.x = j.at(0).get<double>();
+        if (j.size() >= 2)
+            value.y = j.at(1).get<double>();
+        else
+            value.y = value.x;
+    }
+}
+
+// read a number or an expression (string) for a component of a field
+void readNumber(Reader &r, const json &j, double &value, std::string_view key, int component) {
+    if (j.is_string())
+        r.bind(key, component, j.get_ref<const std::string &>());
+    else
+        value = j.get<double>();
+}
+
+// read fields that may be given as expressions
+void read(Reader &r, const json &j, double &value, std::string_view key) {
+    r.unbind(key);
+    readNumber(r, j, value, key, -1);
+}
+
+void read(Reader &r, const json &j, double2 &value, std::string_view key) {
+    r.unbind(key);
+    readNumber(r, j.at(0), value.x, key, 0);
+    readNumber(r, j.at(1), value.y, key, 1);
+}
+
+void read(Reader &r, const json &j, double3 &value, std::string_view key) {
+    r.unbind(key);
+    readNumber(r, j.at(0), value.x, key, 0);
+    readNumber(r, j.at(1), value.y, key, 1);
+    readNumber(r, j.at(2), value.z, key, 2);
+}
+
+void readRelaxed(Reader &r, const json &j, double2 &value, std::string_view key) {
+    r.unbind(key);
+    if (j.is_array() && j.size() >= 2) {
+        readNumber(r, j.at(0), value.x, key, 0);
+        readNumber(r, j.at(1), value.y, key, 1);
+    } else {
+        const json &v = j.is_array() ? j.at(0) : j;
+        readNumber(r, v, value.x, key, -1);
+        value.y = value.x;
+    }
+}
+
+void read(const json &j, double2 &value) {
+    value.x = j.at(0).get<double>();
+    value.y = j.at(1).get<double>();
+}
+
+void read(const json &j, double3 &value) {
+    value.x = j.at(0).get<double>();
+    value.y = j.at(1).get<double>();
+    value.z = j.at(2).get<double>();
+}
+
+
+constexpr Name<Footprint::Pad::Type> padTypes[] = {
+    {"single", Footprint::Pad::Type::SINGLE},
+    {"dual", Footprint::Pad::Type::DUAL},
+    {"quad", Footprint::Pad::Type::QUAD},
+    {"grid", Footprint::Pad::Type::GRID},
+};
+
+constexpr Name<Footprint::Pad::Numbering> numberings[] = {
+    {"circular", Footprint::Pad::Numbering::CIRCULAR},
+    {"columns", Footprint::Pad::Numbering::COLUMNS},
+    {"rows", Footprint::Pad::Numbering::ROWS},
+};
+
+constexpr Name<Footprint::Land::Lead> leads[] = {
+    {"gullwing", Footprint::Land::Lead::GULLWING},
+    {"jlead", Footprint::Land::Lead::JLEAD},
+    {"chip", Footprint::Land::Lead::CHIP},
+    {"flat", Footprint::Land::Lead::FLAT},
+};
+
+using Land = Footprint::Land;
+constexpr Field<Land> landFields[] = {
+    {"lead", [](Reader &r, const json &j, Land &land) {readEnum(r, j, leads, land.lead, "lead");}},
+    {"span", [](Reader &r, const json &j, Land &land) {read(r, j, land.span, "land.span");}},
+    {"terminal", [](Reader &r, const json &j, Land &land) {read(r, j, land.terminal, "land.terminal");}},
+    {"width", [](Reader &r, const json &j, Land &land) {read(r, j, land.width, "land.width");}},
+};
+
+using Pad = Footprint::Pad;
+constexpr Field<Pad> padFields[] = {
+    {"type", [](Reader &r, const json &j, Pad &pad) {readEnum(r, j, padTypes, pad.type, "type");}},
+    {"position", [](Reader &r, const json &j, Pad &pad) {read(r, j, pad.position, "position");}},
+    {"distance", [](Reader &r, const json &j, Pad &pad) {readRelaxed(r, j, pad.distance, "distance");}},
+    {"pitch", [](Reader &r, const json &j, Pad &pad) {read(r, j, pad.pitch, "pitch");}},
+    {"shift", [](Reader &r, const json &j, Pad &pad) {read(r, j, pad.shift, "shift");}},
+    {"size", [](Reader &r, const json &j, Pad &pad) {readRelaxed(r, j, pad.size, "size");}},
+    {"offset", [](Reader &r, const json &j, Pad &pad) {readRelaxed(r, j, pad.offset, "offset");}},
+    {"shape", [](Reader &r, const json &j, Pad &pad) {read(r, j, pad.shape, "shape");}},
+    {"drillSize", [](Reader &r, const json &j, Pad &pad) {readRelaxed(r, j, pad.drillSize, "drillSize");}},
+    {"drillOffset", [](Reader &r, const json &j, Pad &pad) {readRelaxed(r, j, pad.drillOffset, "drillOffset");}},
+    {"clearance", [](Reader &r, const json &j, Pad &pad) {read(r, j, pad.clearance, "clearance");}},
+    {"maskMargin", [](Reader &r, const json &j, Pad &pad) {read(r, j, pad.maskMargin, "maskMargin");}},
+    {"back", [](Reader &r, const json &j, Pad &pad) {read(j, pad.back);}},
+    {"jumper", [](Reader &r, const json &j, Pad &pad) {read(j, pad.jumper);}},
+    {"mask", [](Reader &r, const json &j, Pad &pad) {read(j, pad.mask);}},
+    {"paste", [](Reader &r, const json &j, Pad &pad) {read(j, pad.paste);}},
+    {"count", [](Reader &r, const json &j, Pad &pad) {read(j, pad.count);}},
+    {"mirror", [](Reader &r, const json &j, Pad &pad) {read(j, pad.mirror);}},
+    {"numbering", [](Reader &r, const json &j, Pad &pad) {readEnum(r, j, numberings, pad.numbering, "numbering");}},
+    {"double", [](Reader &r, const json &j, Pad &pad) {read(j, pad.double_);}},
+    {"number", [](Reader &r, const json &j, Pad &pad) {read(j, pad.number);}},
+    {"increment", [](Reader &r, const json &j, Pad &pad) {read(j, pad.increment);}},
+    {"names", [](Reader &r, const json &j, Pad &pad) {
+        for (auto &name : j)
+            pad.names.push_back(name.get<std::string>());
+    }},
+    {"land", [](Reader &r, const json &j, Pad &pad) {readFields(r, j, landFields, pad.land, "land");}},
+};
+
+void readPad(Reader &r, const json &j, Pad &pad) {
+    uint64_t read = readFields(r, j, padFields, pad, "pad");
+
+    // a jumper has no mask and paste unless given explicitly
+    if (pad.jumper) {
+        if (!(read & bit(padFields, "mask")))
+            pad.mask = false;
+        if (!(read & bit(padFields, "paste")))
+            pad.paste = false;
+    }
+}
+
+using Line = Footprint::Line;
+constexpr Field<Line> lineFields[] = {
+    {"layer", [](Reader &r, const json &j, Line &line) {read(j, line.layer);}},
+    {"width", [](Reader &r, const json &j, Line &line) {read(j, line.width);}},
+    {"points", [](Reader &r, const json &j, Line &line) {
+        // list of points as x, y pairs
+        int size = j.size();
+        for (int i = 0; i < size - 1; i += 2) {
+            double x = j.at(i + 0).get<double>();
+            double y = j.at(i + 1).get<double>();
+            line.points.emplace_back(x, y);
+        }
+    }},
+};
+
+void readLine(Reader &r, const json &j, Line &line) {
+    readFields(r, j, lineFields, line, "line");
+}
+
+using Circle = Footprint::Circle;
+constexpr Field<Circle> circleFields[] = {
+    {"layer", [](Reader &r, const json &j, Circle &circle) {read(j, circle.layer);}},
+    {"fill", [](Reader &r, const json &j, Circle &circle) {read(j, circle.fill);}},
+    {"width", [](Reader &r, const json &j, Circle &circle) {read(j, circle.width);}},
+    {"center", [](Reader &r, const json &j, Circle &circle) {read(j, circle.center);}},
+    {"diameter", [](Reader &r, const json &j, Circle &circle) {circle.radius = j.get<double>() * 0.5;}},
+    {"radius", [](Reader &r, const json &j, Circle &circle) {read(j, circle.radius);}},
+};
+
+void readCircle(Reader &r, const json &j, Circle &circle) {
+    uint64_t read = readFields(r, j, circleFields, circle, "circle");
+
+    // filled circle has zero width unless given explicitly
+    if (circle.fill && !(read & bit(circleFields, "width")))
+        circle.width = 0;
+
+    // radius has precedence over diameter
+    constexpr uint64_t both = bit(circleFields, "diameter") | bit(circleFields, "radius");
+    if ((read & both) == both)
+        circle.radius = j["radius"].get<double>();
+}
+
+void removePadBindings(Footprint &footprint) {
+    auto &bindings = footprint.bindings;
+    bindings.erase(std::remove_if(bindings.begin(), bindings.end(),
+        [](const Footprint::Binding &binding) {return binding.pad >= 0;}), bindings.end());
+}
+
+// read a list of objects
+template <typename T>
+void readList(Reader &r, const json &j, std::vector<T> &list, void (*readItem)(Reader &, const json &, T &)) {
+    int count = j.size();
+    list.resize(count);
+    for (int i = 0; i < count; ++i)
+        readItem(r, j.at(i), list[i]);
+}
+
+// read pads, bindings of inherited pads are removed because pads are not inherited
+void readPads(Reader &r, const json &j, Footprint &footprint) {
+    removePadBindings(footprint);
+    int count = j.size();
+    footprint.pads.resize(count);
+    for (int i = 0; i < count; ++i) {
+        r.pad = i;
+        readPad(r, j.at(i), footprint.pads[i]);
+    }
+    r.pad = -1;
+}
+
+using Body = Footprint::Body;
+constexpr Field<Body> bodyFields[] = {
+    {"size", [](Reader &r, const json &j, Body &body) {read(r, j, body.size, "body.size");}},
+    {"offset", [](Reader &r, const json &j, Body &body) {read(r, j, body.offset, "body.offset");}},
+};
+
+// read a parameter sweep, either a number, a list of numbers or a range given as {"from": ..., "to": ..., "step": ...}
+template <typename T>
+void readSweep(Reader &r, const json &j, std::vector<T> &values, std::string_view key) {
+    values.clear();
+    if (j.is_number()) {
+        values.push_back(j.get<T>());
+    } else if (j.is_array()) {
+        for (auto &value : j)
+            values.push_back(value.get<T>());
+    } else if (j.is_object()) {
+        T from = j.at("from").get<T>();
+        T to = j.at("to").get<T>();
+        T step = j.contains("step") ? j["step"].get<T>() : T(1);
+        if (step <= 0) {
+            r.warning("step must be positive for " + std::string(key));
+            return;
+        }
+
+        // add half a step to the end to be robust against rounding errors
+        int count = int((to - from + step * 0.5) / step) + 1;
+        for (int i = 0; i < count; ++i)
+            values.push_back(from + T(i) * step);
+    }
+}
+
+using Variants = Footprint::Variants;
+constexpr Field<Variants> variantsFields[] = {
+    {"pad", [](Reader &r, const json &j, Variants &variants) {read(j, variants.pad);}},
+    {"count", [](Reader &r, const json &j, Variants &variants) {readSweep(r, j, variants.counts, "count");}},
+    {"rows", [](Reader &r, const json &j, Variants &variants) {readSweep(r, j, variants.rows, "rows");}},
+    {"pitch", [](Reader &r, const json &j, Variants &variants) {readSweep(r, j, variants.pitches, "pitch");}},
+};
+
+void readVariants(Reader &r, const json &j, Variants &variants) {
+    variants = {};
+    readFields(r, j, variantsFields, variants, "variants");
+}
+
+constexpr Name<Footprint::Type> footprintTypes[] = {
+    {"detect", Footprint::Type::DETECT},
+    {"through hole", Footprint::Type::THROUGH_HOLE},
+    {"smd", Footprint::Type::SMD},
+};
+
+constexpr Name<Footprint::Orientation> orientations[] = {
+    {"bottom-left", Footprint::Orientation::BOTTOM_LEFT},
+    {"bottom-right", Footprint::Orientation::BOTTOM_RIGHT},
+    {"top-left", Footprint::Orientation::TOP_LEFT},
+    {"top-right", Footprint::Orientation::TOP_RIGHT},
+};
+
+constexpr Name<Footprint::Density> densities[] = {
+    {"most", Footprint::Density::MOST},
+    {"nominal", Footprint::Density::NOMINAL},
+    {"least", Footprint::Density::LEAST},
+};
+
+constexpr Field<Footprint> footprintFields[] = {
+    // inherit is handled before all other fields
+    {"inherit", [](Reader &r, const json &j, Footprint &footprint) {}},
+    {"template", [](Reader &r, const json &j, Footprint &footprint) {read(j, footprint.template_);}},
+    {"description", [](Reader &r, const json &j, Footprint &footprint) {read(j, footprint.description);}},
+    {"type", [](Reader &r, const json &j, Footprint &footprint) {readEnum(r, j, footprintTypes, footprint.type, "type");}},
+    {"body", [](Reader &r, const json &j, Footprint &footprint) {
+        readFields(r, j, bodyFields, footprint.body, "body");
+    }},
+    {"silkscreen", [](Reader &r, const json &j, Footprint &footprint) {read(j, footprint.silkscreen);}},
+    {"silkscreenAdd", [](Reader &r, const json &j, Footprint &footprint) {
+        readRelaxed(r, j, footprint.silkscreenAdd, "silkscreenAdd");
+    }},
+    {"courtyard", [](Reader &r, const json &j, Footprint &footprint) {read(j, footprint.courtyard);}},
+    {"courtyardAdd", [](Reader &r, const json &j, Footprint &footprint) {
+        readRelaxed(r, j, footprint.courtyardAdd, "courtyardAdd");
+    }},
+    {"position", [](Reader &r, const json &j, Footprint &footprint) {read(r, j, footprint.position, "position");}},
+    {"orientation", [](Reader &r, const json &j, Footprint &footprint) {
+        readEnum(r, j, orientations, footprint.orientation, "orientation");
+    }},
+    {"density", [](Reader &r, const json &j, Footprint &footprint) {
+        readEnum(r, j, densities, footprint.density, "density");
+    }},
+    {"pads", [](Reader &r, const json &j, Footprint &footprint) {readPads(r, j, footprint);}},
+    {"lines", [](Reader &r, const json &j, Footprint &footprint) {readList(r, j, footprint.lines, readLine);}},
+    {"circles", [](Reader &r, const json &j, Footprint &footprint) {readList(r, j, footprint.circles, readCircle);}},
+    {"variants", [](Reader &r, const json &j, Footprint &footprint) {readVariants(r, j, footprint.variants);}},
+    {"parameters", [](Reader &r, const json &j, Footprint &footprint) {
+        for (auto it = j.begin(); it != j.end(); ++it)
+            footprint.parameters[it.key()] = it.value().get<double>();
+    }},
+};
+
+// pointer to a component of a field
+double *component(double &value, int component) {
+    return &value;
+}
+
+double *component(double2 &value, int component) {
+    return component == 0 ? &value.x : &value.y;
+}
+
+double *component(double3 &value, int component) {
+    return component == 0 ? &value.x : component == 1 ? &value.y : &value.z;
+}
+
+// field that can be given as expression
+struct BoundField {
+    std::string_view key;
+    int componentCount;
+    double *(*get)(Footprint &footprint, int pad, int c);
+};
+
+constexpr BoundField boundFields[] = {
+    {"position", 2, [](Footprint &f, int p, int c) {return component(p < 0 ? f.position : f.pads[p].position, c);}},
+    {"distance", 2, [](Footprint &f, int p, int c) {return component(f.pads[p].distance, c);}},
+    {"pitch", 1, [](Footprint &f, int p, int c) {return component(f.pads[p].pitch, c);}},
+    {"shift", 1, [](Footprint &f, int p, int c) {return component(f.pads[p].shift, c);}},
+    {"size", 2, [](Footprint &f, int p, int c) {return component(f.pads[p].size, c);}},
+    {"offset", 2, [](Footprint &f, int p, int c) {return component(f.pads[p].offset, c);}},
+    {"shape", 1, [](Footprint &f, int p, int c) {return component(f.pads[p].shape, c);}},
+    {"drillSize", 2, [](Footprint &f, int p, int c) {return component(f.pads[p].drillSize, c);}},
+    {"drillOffset", 2, [](Footprint &f, int p, int c) {return component(f.pads[p].drillOffset, c);}},
+    {"clearance", 1, [](Footprint &f, int p, int c) {return component(f.pads[p].clearance, c);}},
+    {"maskMargin", 1, [](Footprint &f, int p, int c) {return component(f.pads[p].maskMargin, c);}},
+    {"land.span", 2, [](Footprint &f, int p, int c) {return component(f.pads[p].land.span, c);}},
+    {"land.terminal", 2, [](Footprint &f, int p, int c) {return component(f.pads[p].land.terminal, c);}},
+    {"land.width", 2, [](Footprint &f, int p, int c) {return component(f.pads[p].land.width, c);}},
+    {"silkscreenAdd", 2, [](Footprint &f, int p, int c) {return component(f.silkscreenAdd, c);}},
+    {"courtyardAdd", 2, [](Footprint &f, int p, int c) {return component(f.courtyardAdd, c);}},
+    {"body.size", 3, [](Footprint &f, int p, int c) {return component(f.body.size, c);}},
+    {"body.offset", 3, [](Footprint &f, int p, int c) {return component(f.body.offset, c);}},
+};
+
+// collects the names of all footprints that are referenced by inherit without building a json document. Also collects
+// the referenced footprints that come after a footprint that inherits from them
+struct InheritScanner : public nlohmann::json_sax<json> {
+    std::set<std::string, std::less<>> &names;
+    std::set<std::string, std::less<>> &late;
+    int depth = 0;
+    bool inherit = false;
+
+    InheritScanner(std::set<std::string, std::less<>> &names, std::set<std::string, std::less<>> &late)
+        : names(names), late(late) {}
+
+    bool null() override {this->inherit = false; return true;}
+    bool boolean(bool val) override {this->inherit = false; return true;}
+    bool number_integer(number_integer_t val) override {this->inherit = false; return true;}
+    bool number_unsigned(number_unsigned_t val) override {this->inherit = false; return true;}
+    bool number_float(number_float_t val, const string_t &s) override {this->inherit = false; return true;}
+    bool binary(binary_t &val) override {this->inherit = false; return true;}
+    bool string(string_t &val) override {
+        if (this->inherit)
+            this->names.insert(val);
+        this->inherit = false;
+        return true;
+    }
+    bool start_object(size_t elements) override {++this->depth; this->inherit = false; return true;}
+    bool end_object() override {--this->depth; return true;}
+    bool start_array(size_t elements) override {++this->depth; this->inherit = false; return true;}
+    bool end_array() override {--this->depth; return true;}
+    bool key(string_t &val) override {
+        // a footprint is a key at depth 1, it comes late if it was referenced before
+        if (this->depth == 1 && this->names.count(val) > 0)
+            this->late.insert(val);
+
+        // inherit is a key of a footprint which is at depth 2
+        this->inherit = this->depth == 2 && val == "inherit";
+        return true;
+    }
+    bool parse_error(size_t position, const std::string &lastToken, const nlohmann::detail::exception &ex) override {
+        return false;
+    }
+};
+
+// builds the value of each footprint from SAX events and passes it to a callback as soon as it is complete, so that
+// only one footprint is in memory. Used for the binary formats which have no parser callback
+struct FootprintBuilder : public nlohmann::json_sax<json> {
+    std::function<void (const std::string &name, json &value)> callback;
+    std::string name;
+    json value;
+
+    // containers of the footprint that are not complete yet and key of the next value of an object
+    std::vector<json *> stack;
+    std::string valueKey;
+    bool root = false;
+    std::string error;
+
+    FootprintBuilder(std::function<void (const std::string &name, json &value)> callback)
+        : callback(std::move(callback)) {}
+
+    // add a value to the current container or complete the footprint if it is a scalar
+    json *add(json &&v) {
+        if (this->stack.empty()) {
+            this->value = std::move(v);
+            return &this->value;
+        }
+        json &container = *this->stack.back();
+        if (container.is_object())
+            return &(container[this->valueKey] = std::move(v));
+        container.push_back(std::move(v));
+        return &container.back();
+    }
+
+    bool scalar(json &&v) {
+        bool complete = this->stack.empty();
+        add(std::move(v));
+        if (complete)
+            emit();
+        return true;
+    }
+
+    bool start(json &&v) {
+        this->stack.push_back(add(std::move(v)));
+        return true;
+    }
+
+    bool end() {
+        if (this->stack.empty()) {
+            // end of the library
+            this->root = false;
+            return true;
+        }
+        this->stack.pop_back();
+        if (this->stack.empty())
+            emit();
+        return true;
+    }
+
+    void emit() {
+        this->callback(this->name, this->value);
+        this->value = nullptr;
+    }
+
+    bool null() override {return scalar(nullptr);}
+    bool boolean(bool val) override {return scalar(val);}
+    bool number_integer(number_integer_t val) override {return scalar(val);}
+    bool number_unsigned(number_unsigned_t val) override {return scalar(val);}
+    bool number_float(number_float_t val, const string_t &s) override {return scalar(val);}
+    bool binary(binary_t &val) override {return scalar(json::binary(val));}
+    bool string(string_t &val) override {return scalar(std::move(val));}
+    bool start_object(size_t elements) override {
+        if (!this->root && this->stack.empty()) {
+            this->root = true;
+            return true;
+        }
+        return start(json::object());
+    }
+    bool end_object() override {return end();}
+    bool start_array(size_t elements) override {
+        if (!this->root) {
+            this->error = "library must be an object";
+            return false;
+        }
+        return start(json::array());
+    }
+    bool end_array() override {return end();}
+    bool key(string_t &val) override {
+        if (this->stack.empty())
+            this->name = val;
+        else
+            this->valueKey = val;
+        return true;
+    }
+    bool parse_error(size_t position, const std::string &lastToken, const nlohmann::detail::exception &ex) override {
+        this->error = ex.what();
+        return false;
+    }
+};
+
+} // namespace
+
+
+void readFootprint(const json &j, const std::string &name, std::map<std::string, Footprint> &footprints,
+    Footprint &footprint)
+{
+    Reader r{name, footprint};
+
+    // inherit existing footprint
+    auto inherit = j.find("inherit");
+    if (inherit != j.end()) {
+        auto it = footprints.find(inherit->get<std::string>());
+        if (it != footprints.end()) {
+            footprint = it->second;
+            footprint.template_ = false;
+            footprint.variants = {};
+            footprint.inherit = it->first;
+        } else {
+            r.warning("footprint to inherit from not found: " + inherit->get<std::string>());
+        }
+    }
+
+    uint64_t read = readFields(r, j, footprintFields, footprint, "footprint");
+
+    // pads are not inherited
+    if (!(read & bit(footprintFields, "pads"))) {
+        footprint.pads.clear();
+        removePadBindings(footprint);
+    }
+
+    // evaluate expressions, a footprint with an unknown parameter would silently get wrong geometry
+    std::string error;
+    if (!evaluateBindings(footprint, error))
+        throw std::runtime_error(error);
+
+    // calculate pad geometry from component dimensions
+    if (!solveLandPatterns(footprint))
+        r.warning("land pattern requires a single, dual or quad pad array");
+
+    // check variants
+    auto &variants = footprint.variants;
+    if (!variants.empty()) {
+        if (variants.pad < 0 || variants.pad >= int(footprint.pads.size())) {
+            r.warning("variants refer to pad " + std::to_string(variants.pad) + " which does not exist");
+            variants = {};
+        } else {
+            auto type = footprint.pads[variants.pad].type;
+            for (int rows : variants.rows) {
+                if ((rows != 1 && rows != 2) || type == Pad::Type::QUAD || type == Pad::Type::GRID) {
+                    r.warning("rows of variants must be 1 or 2 and require a single or dual pad array");
+                    variants.rows.clear();
+                    break;
+                }
+            }
+            if (variants.size() > 1 && name.find('{') == std::string::npos)
+                r.warning("name of footprint with variants contains no placeholder such as {count}");
+        }
+    }
+}
+
+LibraryFormat getLibraryFormat(const fs::path &path, std::string_view data) {
+    auto extension = path.extension();
+    if (extension == ".cbor")
+        return LibraryFormat::CBOR;
+    if (extension == ".msgpack" || extension == ".mpk")
+        return LibraryFormat::MSGPACK;
+    if (extension == ".json" || data.empty())
+        return LibraryFormat::JSON;
+
+    // the library is a map: cbor self-described tag (d9 d9 f7) or major type 5, msgpack fixmap, map16 or map32
+    uint8_t first = data[0];
+    if (first == 0xd9 || (first >= 0xa0 && first <= 0xbf))
+        return LibraryFormat::CBOR;
+    if ((first >= 0x80 && first <= 0x8f) || first == 0xde || first == 0xdf)
+        return LibraryFormat::MSGPACK;
+    return LibraryFormat::JSON;
+}
+
+json parseLibrary(std::string_view data, LibraryFormat format) {
+    switch (format) {
+    case LibraryFormat::CBOR:
+        // ignore tags such as the self-described tag (d9 d9 f7)
+        return json::from_cbor(data.begin(), data.end(), true, true, json::cbor_tag_handler_t::ignore);
+    case LibraryFormat::MSGPACK:
+        return json::from_msgpack(data.begin(), data.end());
+    default:
+        return json::parse(data.begin(), data.end(),
+            nullptr, // callback
+            true, // allow exceptions
+            true); // ignore comments
+    }
+}
+
+// generate SAX events for a library. json::sax_parse() has no cbor tag handler, therefore binary formats use the
+// binary reader directly so that cbor tags are ignored as in parseLibrary()
+template <typename SAX>
+static bool saxParse(std::string_view data, LibraryFormat format, SAX *sax) {
+    if (format == LibraryFormat::JSON)
+        return json::sax_parse(data.begin(), data.end(), sax, json::input_format_t::json, true, true);
+    auto inputFormat = format == LibraryFormat::CBOR ? json::input_format_t::cbor : json::input_format_t::msgpack;
+    auto input = nlohmann::detail::input_adapter(data.begin(), data.end());
+    return nlohmann::detail::binary_reader<json, decltype(input), SAX>(std::move(input), inputFormat)
+        .sax_parse(inputFormat, sax, true, json::cbor_tag_handler_t::ignore);
+}
+
+// resolve all footprints of a parsed library. A footprint is resolved after the footprint it inherits from, so the
+// order of the keys does not matter
+static void readFootprints(const json &j, std::map<std::string, Footprint> &footprints) {
+    MemoryScope resolveScope(MemoryStage::RESOLVE);
+    std::set<std::string_view> visited;
+    std::vector<json::const_iterator> chain;
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        // follow inherit up to a footprint that is already resolved, a missing footprint or a cycle
+        chain.clear();
+        for (auto current = it; visited.insert(current.key()).second;) {
+            chain.push_back(current);
+            auto &value = current.value();
+            auto inherit = value.find("inherit");
+            if (inherit == value.end() || !inherit->is_string())
+                break;
+            current = j.find(inherit->get_ref<const std::string &>());
+            if (current == j.end())
+                break;
+        }
+
+        // resolve the chain starting at the footprint that is inherited from
+        for (auto c = chain.rbegin(); c != chain.rend(); ++c) {
+            const std::string &name = (*c).key();
+            Footprint footprint;
+            try {
+                readFootprint((*c).value(), name, footprints, footprint);
+                footprints[name] = std::move(footprint);
+            } catch (std::exception &e) {
+                // parsing the json file failed
+                reportError(name, e.what());
+            }
+        }
+    }
+}
+
+void readJson(const fs::path &path, std::map<std::string, Footprint> &footprints) {
+    // read config
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        reportError({}, "could not open file " + path.string());
+        return;
+    }
+    auto d = file.data();
+    try {
+        MemoryScope parseScope(MemoryStage::PARSE);
+        json j = parseLibrary(d, getLibraryFormat(path, d));
+        readFootprints(j, footprints);
+    } catch (std::exception &e) {
+        // parsing the file failed
+        reportError({}, std::string("json: ") + e.what());
+    }
+}
+
+void readJson(std::istream &s, std::map<std::string, Footprint> &footprints) {
+    try {
+        MemoryScope parseScope(MemoryStage::PARSE);
+        json j = json::parse(s,
+            nullptr, // callback
+            true, // allow exceptions
+            true); // ignore comments
+        readFootprints(j, footprints);
+    } catch (std::exception &e) {
+        // parsing the json file failed
+        reportError({}, std::string("json: ") + e.what());
+    }
+}
+
+void streamJson(const fs::path &path,
+    const std::function<void (const std::string &name, Footprint &&footprint)> &callback)
+{
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        reportError({}, "could not open file " + path.string());
+        return;
+    }
+    auto d = file.data();
+    MemoryScope parseScope(MemoryStage::PARSE);
+
+    // first pass: find footprints that are referenced by inherit, errors are reported by the second pass
+    std::set<std::string, std::less<>> referenced;
+    std::set<std::string, std::less<>> late;
+    InheritScanner scanner(referenced, late);
+    auto format = getLibraryFormat(path, d);
+    saxParse(d, format, &scanner);
+
+    // the footprint to inherit from has to be resolved first, in normal mode the order of the file does not matter
+    auto checkOrder = [&late](const json &j) {
+        auto inherit = j.find("inherit");
+        if (inherit != j.end() && inherit->is_string() && late.count(inherit->get_ref<const std::string &>()) > 0) {
+            throw std::runtime_error("footprint to inherit from comes later in the file: "
+                + inherit->get<std::string>() + ", --stream requires it to come first");
+        }
+    };
+
+    // second pass: resolve each footprint as soon as it is parsed and discard its json
+    std::map<std::string, Footprint> footprints;
+    auto resolve = [&](const std::string &name, const json &parsed) {
+        MemoryScope resolveScope(MemoryStage::RESOLVE);
+        Footprint footprint;
+        try {
+            checkOrder(parsed);
+            readFootprint(parsed, name, footprints, footprint);
+            if (referenced.count(name) > 0)
+                footprints[name] = footprint;
+            callback(name, std::move(footprint));
+        } catch (std::exception &e) {
+            reportError(name, e.what());
+        }
+        late.erase(name);
+    };
+
+    // binary formats have no parser callback, each footprint is built from SAX events
+    if (format != LibraryFormat::JSON) {
+        FootprintBuilder builder(resolve);
+        if (!saxParse(d, format, &builder))
+            reportError({}, "json: " + builder.error);
+        return;
+    }
+
+    std::string name;
+    auto parseCallback = [&](int depth, json::parse_event_t event, json &parsed) {
+        if (depth != 1)
+            return true;
+        if (event == json::parse_event_t::key) {
+            name = parsed.get<std::string>();
+            return true;
+        }
+        if (event != json::parse_event_t::object_end && event != json::parse_event_t::value)
+            return true;
+        resolve(name, parsed);
+
+        // discard the parsed value
+        return false;
+    };
+    try {
+        // the root object remains empty because all footprints are discarded
+        json j = json::parse(d.data(), d.data() + d.size(), parseCallback,
+            true, // allow exceptions
+            true); // ignore comments
+    } catch (std::exception &e) {
+        // parsing the json file failed
+        reportError({}, std::string("json: ") + e.what());
+    }
+}
+
+bool evaluateBindings(Footprint &footprint, std::string &error) {
+    if (footprint.bindings.empty())
+        return true;
+
+    // built-in variables refer to the pad array the variants apply to. A binding of its pitch is evaluated first and
+    // the built-ins are read for each binding, so that other bindings see the evaluated pitch
+    int padIndex = footprint.variants.pad;
+    const Footprint::Pad *pad = padIndex >= 0 && padIndex < int(footprint.pads.size())
+        ? &footprint.pads[padIndex] : nullptr;
+    std::vector<const Footprint::Binding *> bindings;
+    for (auto &binding : footprint.bindings) {
+        if (binding.pad < int(footprint.pads.size()))
+            bindings.push_back(&binding);
+    }
+    std::stable_partition(bindings.begin(), bindings.end(), [padIndex](const Footprint::Binding *binding) {
+        return binding->pad == padIndex && binding->key == "pitch";
+    });
+
+    bool success = true;
+    std::vector<double> values;
+    for (auto binding : bindings) {
+        // look up values of variables
+        auto &variables = binding->expression.getVariables();
+        values.resize(variables.size());
+        for (size_t i = 0; i < variables.size(); ++i) {
+            auto &name = variables[i];
+            if (name == "count") {
+                values[i] = pad != nullptr ? pad->count / pad->getRowCount() : 0;
+            } else if (name == "rows") {
+                values[i] = pad != nullptr ? pad->getRowCount() : 0;
+            } else if (name == "pins") {
+                values[i] = pad != nullptr ? pad->count : 0;
+            } else if (name == "pitch") {
+                values[i] = pad != nullptr ? pad->pitch : 0;
+            } else {
+                auto it = footprint.parameters.find(name);
+                if (it != footprint.parameters.end()) {
+                    values[i] = it->second;
+                } else {
+                    values[i] = 0;
+                    if (success)
+                        error = "unknown parameter " + name + " in expression \"" + binding->source + "\"";
+                    success = false;
+                }
+            }
+        }
+        double value = binding->expression.evaluate(values.data());
+
+        // set field
+        for (auto &field : boundFields) {
+            if (field.key == binding->key) {
+                if (binding->component < 0) {
+                    for (int c = 0; c < field.componentCount; ++c)
+                        *field.get(footprint, binding->pad, c) = value;
+                } else {
+                    *field.get(footprint, binding->pad, binding->component) = value;
+                }
+                break;
+            }
+        }
+    }
+    return success;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Footprint.hpp"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <map>
+#include <string>
+#include <string_view>
+
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+
+// format of a footprint library, binary formats skip text parsing for libraries generated by scripts
+enum class LibraryFormat {
+    JSON,
+    CBOR,
+    MSGPACK,
+};
+
+// get the format of a library from the extension (.cbor, .msgpack) or from the first bytes of the data
+LibraryFormat getLibraryFormat(const fs::path &path, std::string_view data = {});
+
+// parse a library without resolving the footprints, throws if parsing fails
+json parseLibrary(std::string_view data, LibraryFormat format);
+
+// read a footprint from json, a footprint to inherit from is looked up in footprints. Unknown keys and values
+// generate warnings that contain the name of the footprint
+void readFootprint(const json &j, const std::string &name, std::map<std::string, Footprint> &footprints,
+    Footprint &footprint);
+
+// evaluate the fields of a footprint that are given as expressions, sets error and returns false if a parameter is
+// unknown. The variables count, rows, pins and pitch refer to the pad array the variants apply to, a binding of its
+// pitch is evaluated before the other bindings
+bool evaluateBindings(Footprint &footprint, std::string &error);
+
+// read all footprints from a json, cbor or msgpack file, a footprint may inherit from a footprint anywhere in the file
+void readJson(const fs::path &path, std::map<std::string, Footprint> &footprints);
+
+// read all footprints from a stream containing json
+void readJson(std::istream &s, std::map<std::string, Footprint> &footprints);
+
+// read footprints from a json file one by one and pass each resolved footprint to a callback, in the order of the
+// file. Only footprints that are referenced by inherit are kept in memory. A footprint that inherits from a footprint
+// further down in the file is an error
+void streamJson(const fs::path &path,
+    const std::function<void (const std::string &name, Footprint &&footprint)> &callback);
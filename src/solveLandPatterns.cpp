@@ -0,0 +1,150 @@
+#include "solveLandPatterns.hpp"
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+using Land = Footprint::Land;
+using Lead = Footprint::Land::Lead;
+
+// fabrication tolerance of the board
+constexpr double fabricationTolerance = 0.05;
+
+// placement tolerance of the assembly machine
+constexpr double placementTolerance = 0.025;
+
+// land dimensions are rounded to this grid (toe outwards, heel inwards)
+constexpr double landGrid = 0.01;
+
+// solder fillet goals (toe, heel, side) indexed by Footprint::Density (most, nominal, least)
+struct Goals {
+    double toe[3];
+    double heel[3];
+    double side[3];
+};
+
+constexpr Goals gullwingGoals = {{0.55, 0.35, 0.15}, {0.45, 0.35, 0.25}, {0.05, 0.03, 0.01}};
+constexpr Goals gullwingFinePitchGoals = {{0.55, 0.35, 0.15}, {0.45, 0.35, 0.25}, {0.01, -0.02, -0.04}};
+constexpr Goals jleadGoals = {{0.10, 0.00, -0.10}, {0.55, 0.35, 0.15}, {0.05, 0.03, 0.01}};
+constexpr Goals chipGoals = {{0.55, 0.35, 0.15}, {0.00, 0.00, 0.00}, {0.05, 0.00, -0.05}};
+constexpr Goals flatGoals = {{0.40, 0.30, 0.20}, {0.00, 0.00, 0.00}, {-0.04, -0.04, -0.04}};
+
+// gull wing leads with a pitch up to this value use the fine pitch side goals
+constexpr double finePitch = 0.625;
+
+const Goals &getGoals(Lead lead, double pitch) {
+    switch (lead) {
+    case Lead::GULLWING:
+        return pitch > 0 && pitch <= finePitch ? gullwingFinePitchGoals : gullwingGoals;
+    case Lead::JLEAD:
+        return jleadGoals;
+    case Lead::CHIP:
+        return chipGoals;
+    default:
+        return flatGoals;
+    }
+}
+
+// input and output of the land pattern equations for a batch of pad arrays in structure of arrays layout, so that
+// the loop in solve() gets vectorized
+struct LandBatch {
+    // component dimensions
+    std::vector<double> spanMin, spanMax;
+    std::vector<double> terminalMin, terminalMax;
+    std::vector<double> widthMin, widthMax;
+
+    // solder fillet goals
+    std::vector<double> toe, heel, side;
+
+    // outer and inner distance of the lands and width of a land
+    std::vector<double> z, g, x;
+
+    void add(const Land &land, const Goals &goals, Footprint::Density density) {
+        int d = int(density);
+        this->spanMin.push_back(land.span.x);
+        this->spanMax.push_back(land.span.y);
+        this->terminalMin.push_back(land.terminal.x);
+        this->terminalMax.push_back(land.terminal.y);
+        this->widthMin.push_back(land.width.x);
+        this->widthMax.push_back(land.width.y);
+        this->toe.push_back(goals.toe[d]);
+        this->heel.push_back(goals.heel[d]);
+        this->side.push_back(goals.side[d]);
+    }
+
+    void solve() {
+        size_t n = this->spanMin.size();
+        this->z.resize(n);
+        this->g.resize(n);
+        this->x.resize(n);
+        constexpr double fp = fabricationTolerance * fabricationTolerance + placementTolerance * placementTolerance;
+        for (size_t i = 0; i < n; ++i) {
+            double spanTolerance = this->spanMax[i] - this->spanMin[i];
+            double terminalTolerance = this->terminalMax[i] - this->terminalMin[i];
+            double widthTolerance = this->widthMax[i] - this->widthMin[i];
+
+            // distance between the heels, the tolerance is the root of the sum of squares instead of the sum
+            double heelMax = this->spanMax[i] - 2 * this->terminalMin[i];
+            double heelTolerance2 = spanTolerance * spanTolerance + 2 * terminalTolerance * terminalTolerance;
+            heelMax -= (spanTolerance + 2 * terminalTolerance - std::sqrt(heelTolerance2)) * 0.5;
+
+            this->z[i] = this->spanMin[i] + 2 * this->toe[i] + std::sqrt(spanTolerance * spanTolerance + fp);
+            this->g[i] = heelMax - 2 * this->heel[i] - std::sqrt(heelTolerance2 + fp);
+            this->x[i] = this->widthMin[i] + 2 * this->side[i] + std::sqrt(widthTolerance * widthTolerance + fp);
+        }
+    }
+};
+
+double roundUp(double value) {
+    return std::ceil(value / landGrid - 1e-6) * landGrid;
+}
+
+double roundDown(double value) {
+    return std::floor(value / landGrid + 1e-6) * landGrid;
+}
+
+} // namespace
+
+
+bool solveLandPatterns(Footprint &footprint) {
+    // collect all pad arrays with a land
+    LandBatch batch;
+    std::vector<Footprint::Pad *> pads;
+    bool success = true;
+    for (auto &pad : footprint.pads) {
+        if (pad.land.lead == Lead::NONE)
+            continue;
+        if (pad.type == Footprint::Pad::Type::GRID) {
+            success = false;
+            continue;
+        }
+        batch.add(pad.land, getGoals(pad.land.lead, pad.pitch), footprint.density);
+        pads.push_back(&pad);
+    }
+    if (pads.empty())
+        return success;
+
+    batch.solve();
+
+    // the lands of a row are along the row, rows of dual arrays are vertical if the orientation is rotated
+    auto o = footprint.orientation;
+    bool rotated = o == Footprint::Orientation::BOTTOM_RIGHT || o == Footprint::Orientation::TOP_LEFT;
+    for (size_t i = 0; i < pads.size(); ++i) {
+        auto &pad = *pads[i];
+        double z = roundUp(batch.z[i]);
+        double g = roundDown(batch.g[i]);
+        double width = roundUp(batch.x[i]);
+        double length = (z - g) * 0.5;
+        double distance = (z + g) * 0.5;
+        if (pad.type == Footprint::Pad::Type::QUAD || !rotated)
+            pad.size = {width, length};
+        else
+            pad.size = {length, width};
+
+        // the position of a single row is given explicitly
+        if (pad.type != Footprint::Pad::Type::SINGLE)
+            pad.distance = {distance, distance};
+    }
+    return success;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Footprint.hpp"
+
+
+// calculate size and distance of all pad arrays of a footprint that have component dimensions (land) using the
+// IPC-7351 equations for the density level of the footprint. Single pad arrays only get the size. Returns false if a
+// land is given for a grid
+bool solveLandPatterns(Footprint &footprint);
@@ -0,0 +1,50 @@
+#include "tessellateBody.hpp"
+#include "makeBody.hpp"
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRep_Tool.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Face.hxx>
+#include <utility>
+
+
+bool tessellateBody(double3 size, double deflection, std::vector<double3> &points, std::vector<int> &triangles) {
+    TopoDS_Shape shape = makeBody({0, 0, 0}, size);
+
+    // mesh all faces in parallel, angular deflection is 0.5 rad
+    BRepMesh_IncrementalMesh mesh(shape, deflection, false, 0.5, true);
+
+    // collect triangles of all faces
+    for (TopExp_Explorer explorer(shape, TopAbs_FACE); explorer.More(); explorer.Next()) {
+        const TopoDS_Face &face = TopoDS::Face(explorer.Current());
+        TopLoc_Location location;
+        const Handle(Poly_Triangulation) &triangulation = BRep_Tool::Triangulation(face, location);
+        if (triangulation.IsNull())
+            continue;
+
+        // nodes (OpenCASCADE indices start at 1)
+        int base = int(points.size()) - 1;
+        gp_Trsf transformation = location.Transformation();
+        int nodeCount = triangulation->NbNodes();
+        for (int i = 1; i <= nodeCount; ++i) {
+            gp_Pnt p = triangulation->Node(i).Transformed(transformation);
+            points.emplace_back(p.X(), p.Y(), p.Z());
+        }
+
+        // triangles, reversed faces have opposite winding
+        bool reversed = face.Orientation() == TopAbs_REVERSED;
+        int triangleCount = triangulation->NbTriangles();
+        for (int i = 1; i <= triangleCount; ++i) {
+            int n1, n2, n3;
+            triangulation->Triangle(i).Get(n1, n2, n3);
+            if (reversed)
+                std::swap(n2, n3);
+            triangles.push_back(base + n1);
+            triangles.push_back(base + n2);
+            triangles.push_back(base + n3);
+        }
+    }
+    return !triangles.empty();
+}
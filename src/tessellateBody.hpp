@@ -0,0 +1,9 @@
+#pragma once
+
+#include "double3.hpp"
+#include <vector>
+
+
+// tessellate the body of a footprint (see makeBody()) with the center at the origin. The deflection is the maximum
+// deviation of the mesh from the shape in mm. Three indices into the points form a triangle
+bool tessellateBody(double3 size, double deflection, std::vector<double3> &points, std::vector<int> &triangles);
@@ -0,0 +1,286 @@
+#include "writeJson.hpp"
+#include "MappedFile.hpp"
+#include "readJson.hpp"
+#include <fstream>
+#include <iostream>
+
+
+static json toJson(double2 value) {
+    return json::array({value.x, value.y});
+}
+
+static json toJson(double3 value) {
+    return json::array({value.x, value.y, value.z});
+}
+
+// write a value that can be read by readRelaxed()
+static json toJsonRelaxed(double2 value) {
+    if (value.x == value.y)
+        return value.x;
+    return toJson(value);
+}
+
+static bool operator !=(double2 a, double2 b) {
+    return a.x != b.x || a.y != b.y;
+}
+
+static bool operator !=(double3 a, double3 b) {
+    return a.x != b.x || a.y != b.y || a.z != b.z;
+}
+
+static void writePad(json &j, const Footprint::Pad &pad) {
+    const Footprint::Pad d;
+
+    // type
+    if (pad.type == Footprint::Pad::Type::DUAL)
+        j["type"] = "dual";
+    else if (pad.type == Footprint::Pad::Type::QUAD)
+        j["type"] = "quad";
+    else if (pad.type == Footprint::Pad::Type::GRID)
+        j["type"] = "grid";
+
+    if (pad.position != d.position)
+        j["position"] = toJson(pad.position);
+    if (pad.distance != d.distance)
+        j["distance"] = toJsonRelaxed(pad.distance);
+    if (pad.pitch != d.pitch)
+        j["pitch"] = pad.pitch;
+    if (pad.shift != d.shift)
+        j["shift"] = pad.shift;
+    if (pad.size != d.size)
+        j["size"] = toJsonRelaxed(pad.size);
+    if (pad.offset != d.offset)
+        j["offset"] = toJsonRelaxed(pad.offset);
+    if (pad.shape != d.shape)
+        j["shape"] = pad.shape;
+    if (pad.drillSize != d.drillSize)
+        j["drillSize"] = toJsonRelaxed(pad.drillSize);
+    if (pad.drillOffset != d.drillOffset)
+        j["drillOffset"] = toJsonRelaxed(pad.drillOffset);
+    if (pad.clearance != d.clearance)
+        j["clearance"] = pad.clearance;
+    if (pad.maskMargin != d.maskMargin)
+        j["maskMargin"] = pad.maskMargin;
+
+    // layers
+    if (pad.back)
+        j["back"] = true;
+    if (pad.jumper)
+        j["jumper"] = true;
+    if (pad.mask != !pad.jumper)
+        j["mask"] = pad.mask;
+    if (pad.paste != !pad.jumper)
+        j["paste"] = pad.paste;
+
+    if (pad.count != d.count)
+        j["count"] = pad.count;
+    if (pad.mirror)
+        j["mirror"] = true;
+
+    // numbering
+    if (pad.numbering == Footprint::Pad::Numbering::COLUMNS)
+        j["numbering"] = "columns";
+    else if (pad.numbering == Footprint::Pad::Numbering::ROWS)
+        j["numbering"] = "rows";
+
+    if (pad.double_)
+        j["double"] = true;
+    if (pad.number != d.number)
+        j["number"] = pad.number;
+    if (pad.increment != d.increment)
+        j["increment"] = pad.increment;
+    if (!pad.names.empty())
+        j["names"] = pad.names;
+
+    // component dimensions for the land pattern
+    if (pad.land.lead != Footprint::Land::Lead::NONE) {
+        json &jl = j["land"];
+        if (pad.land.lead == Footprint::Land::Lead::GULLWING)
+            jl["lead"] = "gullwing";
+        else if (pad.land.lead == Footprint::Land::Lead::JLEAD)
+            jl["lead"] = "jlead";
+        else if (pad.land.lead == Footprint::Land::Lead::CHIP)
+            jl["lead"] = "chip";
+        else
+            jl["lead"] = "flat";
+        jl["span"] = toJson(pad.land.span);
+        jl["terminal"] = toJson(pad.land.terminal);
+        jl["width"] = toJson(pad.land.width);
+    }
+}
+
+static void writeLine(json &j, const Footprint::Line &line) {
+    j["layer"] = line.layer;
+    if (line.width != Footprint::Line().width)
+        j["width"] = line.width;
+    json &jp = j["points"] = json::array();
+    for (auto point : line.points) {
+        jp.push_back(point.x);
+        jp.push_back(point.y);
+    }
+}
+
+static void writeCircle(json &j, const Footprint::Circle &circle) {
+    j["layer"] = circle.layer;
+    if (circle.fill)
+        j["fill"] = true;
+    if (circle.width != (circle.fill ? 0 : Footprint::Circle().width))
+        j["width"] = circle.width;
+    j["center"] = toJson(circle.center);
+    j["radius"] = circle.radius;
+}
+
+void writeFootprint(json &j, const Footprint &footprint) {
+    const Footprint d;
+
+    if (footprint.template_)
+        j["template"] = true;
+    if (!footprint.description.empty())
+        j["description"] = footprint.description;
+
+    // type
+    if (footprint.type == Footprint::Type::THROUGH_HOLE)
+        j["type"] = "through hole";
+    else if (footprint.type == Footprint::Type::SMD)
+        j["type"] = "smd";
+
+    // body
+    if (footprint.body.size != d.body.size || footprint.body.offset != d.body.offset) {
+        json &jb = j["body"];
+        jb["size"] = toJson(footprint.body.size);
+        if (footprint.body.offset != d.body.offset)
+            jb["offset"] = toJson(footprint.body.offset);
+    }
+
+    // silkscreen and courtyard
+    if (footprint.silkscreen != d.silkscreen)
+        j["silkscreen"] = footprint.silkscreen;
+    if (footprint.silkscreenAdd != d.silkscreenAdd)
+        j["silkscreenAdd"] = toJsonRelaxed(footprint.silkscreenAdd);
+    if (footprint.courtyard != d.courtyard)
+        j["courtyard"] = footprint.courtyard;
+    if (footprint.courtyardAdd != d.courtyardAdd)
+        j["courtyardAdd"] = toJsonRelaxed(footprint.courtyardAdd);
+
+    if (footprint.position != d.position)
+        j["position"] = toJson(footprint.position);
+
+    // orientation
+    if (footprint.orientation == Footprint::Orientation::TOP_LEFT)
+        j["orientation"] = "top-left";
+    else if (footprint.orientation == Footprint::Orientation::BOTTOM_RIGHT)
+        j["orientation"] = "bottom-right";
+    else if (footprint.orientation == Footprint::Orientation::TOP_RIGHT)
+        j["orientation"] = "top-right";
+
+    // density level of land patterns
+    if (footprint.density == Footprint::Density::MOST)
+        j["density"] = "most";
+    else if (footprint.density == Footprint::Density::LEAST)
+        j["density"] = "least";
+
+    // pads, lines and circles
+    if (!footprint.pads.empty()) {
+        json &jp = j["pads"] = json::array();
+        for (auto &pad : footprint.pads)
+            writePad(jp.emplace_back(json::object()), pad);
+    }
+    if (!footprint.lines.empty()) {
+        json &jl = j["lines"] = json::array();
+        for (auto &line : footprint.lines)
+            writeLine(jl.emplace_back(json::object()), line);
+    }
+    if (!footprint.circles.empty()) {
+        json &jc = j["circles"] = json::array();
+        for (auto &circle : footprint.circles)
+            writeCircle(jc.emplace_back(json::object()), circle);
+    }
+
+    // parameters and fields given as expressions
+    if (!footprint.parameters.empty()) {
+        json &jp = j["parameters"] = json::object();
+        for (auto &[name, value] : footprint.parameters)
+            jp[name] = value;
+    }
+    for (auto &binding : footprint.bindings) {
+        json &object = binding.pad >= 0 ? j["pads"][binding.pad] : j;
+        // keys of nested fields such as "body.size" or "land.span" contain a dot
+        auto dot = binding.key.find('.');
+        json &field = dot != std::string::npos
+            ? object[binding.key.substr(0, dot)][binding.key.substr(dot + 1)] : object[binding.key];
+        if (binding.component < 0) {
+            field = binding.source;
+        } else {
+            // make sure the field is an array, a relaxed field may have been written as single number
+            if (!field.is_array())
+                field = json::array({field, field});
+            while (int(field.size()) <= binding.component)
+                field.push_back(0);
+            field[binding.component] = binding.source;
+        }
+    }
+
+    // variants
+    auto &variants = footprint.variants;
+    if (!variants.empty()) {
+        json &jv = j["variants"] = json::object();
+        if (variants.pad != 0)
+            jv["pad"] = variants.pad;
+        if (!variants.counts.empty())
+            jv["count"] = variants.counts;
+        if (!variants.rows.empty())
+            jv["rows"] = variants.rows;
+        if (!variants.pitches.empty())
+            jv["pitch"] = variants.pitches;
+    }
+}
+
+bool writeJson(const fs::path &path, const std::map<std::string, Footprint> &footprints) {
+    json j = json::object();
+    for (auto &[name, footprint] : footprints) {
+        json &jf = j[name] = json::object();
+        writeFootprint(jf, footprint);
+    }
+
+    std::ofstream s(path.string());
+    if (!s.is_open()) {
+        std::cerr << "error: could not create file " << path.string() << std::endl;
+        return false;
+    }
+    s << j.dump(4) << std::endl;
+    return true;
+}
+
+bool convertLibrary(const fs::path &input, const fs::path &output) {
+    MappedFile file(input);
+    if (!file.isOpen()) {
+        std::cerr << "error: could not open file " << input.string() << std::endl;
+        return false;
+    }
+    auto d = file.data();
+    json j;
+    try {
+        j = parseLibrary(d, getLibraryFormat(input, d));
+    } catch (std::exception &e) {
+        std::cerr << "error: " << input.string() << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    std::ofstream s(output.string(), std::ios::binary);
+    if (!s.is_open()) {
+        std::cerr << "error: could not create file " << output.string() << std::endl;
+        return false;
+    }
+    auto format = getLibraryFormat(output);
+    if (format == LibraryFormat::JSON) {
+        s << j.dump(4) << std::endl;
+    } else {
+        auto data = format == LibraryFormat::CBOR ? json::to_cbor(j) : json::to_msgpack(j);
+        s.write(reinterpret_cast<const char *>(data.data()), data.size());
+    }
+    if (!s) {
+        std::cerr << "error: could not write file " << output.string() << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Footprint.hpp"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <map>
+#include <string>
+
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+
+// convert a footprint to json, only fields that differ from the defaults are written
+void writeFootprint(json &j, const Footprint &footprint);
+
+// write footprints to a json file in the format read by readJson()
+bool writeJson(const fs::path &path, const std::map<std::string, Footprint> &footprints);
+
+// convert a library between json, cbor and msgpack without resolving the footprints. The format of the input is
+// detected from the extension or the contents, the format of the output follows from its extension
+bool convertLibrary(const fs::path &input, const fs::path &output);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+
+// minimal checks for the tests, a failed check prints its location and the test returns a non-zero exit code
+
+inline int checkFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            ++checkFailures; \
+        } \
+    } while (false)
+
+#define CHECK_NEAR(a, b) CHECK(std::abs((a) - (b)) < 1e-9)
@@ -0,0 +1,82 @@
+#include "check.hpp"
+#include "Expression.hpp"
+#include <string>
+#include <string_view>
+
+
+// compile an expression and evaluate it with the variables x = 2 and y = 3
+static double evaluate(std::string_view source) {
+    Expression e;
+    std::string error;
+    if (!e.compile(source, error)) {
+        std::cerr << "could not compile \"" << source << "\": " << error << std::endl;
+        ++checkFailures;
+        return NAN;
+    }
+    std::vector<double> values;
+    for (auto &name : e.getVariables())
+        values.push_back(name == "x" ? 2 : name == "y" ? 3 : 0);
+    return e.evaluate(values.data());
+}
+
+// compile an expression that is expected to fail and return the error
+static std::string compileError(std::string_view source) {
+    Expression e;
+    std::string error;
+    if (e.compile(source, error)) {
+        std::cerr << "compiled \"" << source << "\" although it is invalid" << std::endl;
+        ++checkFailures;
+    }
+    return error;
+}
+
+int main() {
+    // numbers and precedence
+    CHECK_NEAR(evaluate("1.5"), 1.5);
+    CHECK_NEAR(evaluate(".5"), 0.5);
+    CHECK_NEAR(evaluate("1 + 2 * 3"), 7);
+    CHECK_NEAR(evaluate("(1 + 2) * 3"), 9);
+    CHECK_NEAR(evaluate("10 - 4 - 3"), 3);
+    CHECK_NEAR(evaluate("12 / 3 / 2"), 2);
+    CHECK_NEAR(evaluate("2 * 3 ^ 2"), 18);
+
+    // ^ is right associative and binds stronger than unary minus
+    CHECK_NEAR(evaluate("2 ^ 3 ^ 2"), 512);
+    CHECK_NEAR(evaluate("-2 ^ 2"), -4);
+    CHECK_NEAR(evaluate("2 ^ -1"), 0.5);
+    CHECK_NEAR(evaluate("--3"), 3);
+    CHECK_NEAR(evaluate("+3"), 3);
+
+    // variables, each name is listed once
+    CHECK_NEAR(evaluate("x * y + x"), 8);
+    {
+        Expression e;
+        std::string error;
+        CHECK(e.compile("x * y + x", error));
+        CHECK(e.getVariables().size() == 2);
+    }
+
+    // functions
+    CHECK_NEAR(evaluate("min(x, y)"), 2);
+    CHECK_NEAR(evaluate("max(x, y)"), 3);
+    CHECK_NEAR(evaluate("abs(-x)"), 2);
+    CHECK_NEAR(evaluate("sqrt(16)"), 4);
+    CHECK_NEAR(evaluate("floor(2.7) + ceil(2.2) + round(2.5)"), 8);
+    CHECK_NEAR(evaluate("max(1, min(x * 2, 10)) / 2"), 2);
+
+    // error messages
+    CHECK(compileError("1 +") == "unexpected end");
+    CHECK(compileError("") == "unexpected end");
+    CHECK(compileError("(1 + 2") == "expected ')'");
+    CHECK(compileError("1 2") == "unexpected '2'");
+    CHECK(compileError("1 $ 2") == "unexpected '$'");
+    CHECK(compileError("foo(1)") == "unknown function foo");
+    CHECK(compileError("min(1)") == "expected ','");
+
+    // nesting limit
+    CHECK_NEAR(evaluate(std::string(30, '(') + "1" + std::string(30, ')')), 1);
+    CHECK(compileError(std::string(100000, '(') + "1" + std::string(100000, ')')) == "expression too complex");
+    CHECK(compileError(std::string(100000, '-') + "1") == "expression too complex");
+
+    return checkFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#include "check.hpp"
+#include "LibraryCache.hpp"
+#include <fstream>
+#include <string>
+
+
+// write a file and return its path in the temp directory
+static fs::path writeFile(const std::string &name, std::string_view data) {
+    auto path = fs::temp_directory_path() / name;
+    std::ofstream f(path, std::ios::binary);
+    f.write(data.data(), data.size());
+    return path;
+}
+
+static std::string readFile(const fs::path &path) {
+    std::ifstream f(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+}
+
+// library with a plain footprint and a footprint family with parameters and a binding
+static std::map<std::string, Footprint> createFootprints() {
+    std::map<std::string, Footprint> footprints;
+
+    auto &r = footprints["R0603"];
+    r.description = "resistor";
+    r.type = Footprint::Type::SMD;
+    r.body.size = {1.6, 0.8, 0.45};
+    r.pads.resize(1);
+    r.pads[0].type = Footprint::Pad::Type::DUAL;
+    r.pads[0].count = 1;
+    r.pads[0].size = {0.9, 0.95};
+    r.pads[0].distance = {1.6, 0};
+    r.pads[0].names = {"1", ""};
+    Footprint::Line line;
+    line.layer = "F.Fab";
+    line.points = {{-0.8, -0.4}, {0.8, -0.4}, {0.8, 0.4}};
+    r.lines.push_back(line);
+    Footprint::Circle circle;
+    circle.layer = "F.SilkS";
+    circle.fill = true;
+    circle.radius = 0.1;
+    r.circles.push_back(circle);
+
+    auto &h = footprints["Header_1x{count}_P{pitch}"];
+    h.inherit = "Header";
+    h.pads.resize(1);
+    h.pads[0].type = Footprint::Pad::Type::DUAL;
+    h.pads[0].pitch = 2.54;
+    h.pads[0].drillSize = {1, 1};
+    h.variants.counts = {2, 3, 4};
+    h.variants.pitches = {2.54};
+    h.parameters["rows"] = 3;
+    Footprint::Binding binding;
+    binding.pad = 0;
+    binding.key = "distance";
+    binding.component = 0;
+    binding.source = "pitch * rows";
+    h.bindings.push_back(binding);
+
+    return footprints;
+}
+
+int main() {
+    auto source = writeFile("testLibraryCache.json", "{\"R0603\": {}}");
+    auto path = fs::temp_directory_path() / "testLibraryCache.fpcache";
+    uint64_t hash = hashFile(source);
+    auto footprints = createFootprints();
+    CHECK(writeCache(path, hash, footprints));
+
+    // round trip
+    {
+        LibraryCache cache;
+        CHECK(cache.open(path, hash));
+        CHECK(cache.size() == 2);
+
+        // footprints are sorted by name
+        CHECK(cache.name(0) == "Header_1x{count}_P{pitch}");
+        CHECK(cache.name(1) == "R0603");
+
+        Footprint r;
+        cache.get(1, r);
+        CHECK(r.description == "resistor");
+        CHECK(r.type == Footprint::Type::SMD);
+        CHECK_NEAR(r.body.size.x, 1.6);
+        CHECK_NEAR(r.body.size.z, 0.45);
+        CHECK(r.pads.size() == 1);
+        CHECK(r.pads[0].type == Footprint::Pad::Type::DUAL);
+        CHECK_NEAR(r.pads[0].size.y, 0.95);
+        CHECK_NEAR(r.pads[0].distance.x, 1.6);
+        CHECK(r.pads[0].names.size() == 2 && r.pads[0].names[0] == "1" && r.pads[0].names[1].empty());
+        CHECK(r.pads[0].mask && r.pads[0].paste && !r.pads[0].back);
+        CHECK(r.lines.size() == 1 && r.lines[0].layer == "F.Fab" && r.lines[0].points.size() == 3);
+        CHECK_NEAR(r.lines[0].points[2].y, 0.4);
+        CHECK(r.circles.size() == 1 && r.circles[0].layer == "F.SilkS" && r.circles[0].fill);
+        CHECK_NEAR(r.circles[0].radius, 0.1);
+        CHECK(r.variants.empty() && r.bindings.empty());
+
+        Footprint h;
+        cache.get(0, h);
+        CHECK(h.inherit == "Header");
+        CHECK_NEAR(h.pads[0].pitch, 2.54);
+        CHECK_NEAR(h.pads[0].drillSize.x, 1);
+        CHECK(h.variants.counts == std::vector<int>({2, 3, 4}));
+        CHECK(h.variants.rows.empty());
+        CHECK(h.variants.pitches.size() == 1);
+        CHECK(h.parameters.size() == 1);
+        CHECK_NEAR(h.parameters["rows"], 3);
+
+        // the binding is compiled again from its source
+        CHECK(h.bindings.size() == 1);
+        auto &b = h.bindings[0];
+        CHECK(b.pad == 0 && b.key == "distance" && b.component == 0 && b.source == "pitch * rows");
+        auto &variables = b.expression.getVariables();
+        CHECK(variables.size() == 2);
+        double values[2];
+        for (size_t i = 0; i < variables.size() && i < 2; ++i)
+            values[i] = variables[i] == "pitch" ? 2.54 : 3;
+        CHECK_NEAR(b.expression.evaluate(values), 7.62);
+
+        std::map<std::string, Footprint> all;
+        cache.getAll(all);
+        CHECK(all.size() == 2 && all.count("R0603") == 1);
+    }
+
+    // the source has changed
+    {
+        LibraryCache cache;
+        CHECK(!cache.open(path, hash + 1));
+        CHECK(cache.size() == 0);
+        writeFile("testLibraryCache.json", "{\"R0805\": {}}");
+        CHECK(hashFile(source) != hash);
+    }
+
+    auto data = readFile(path);
+
+    // corrupted magic
+    {
+        auto corrupted = data;
+        corrupted[0] ^= 1;
+        auto p = writeFile("testLibraryCacheMagic.fpcache", corrupted);
+        LibraryCache cache;
+        CHECK(!cache.open(p, hash));
+        fs::remove(p);
+    }
+
+    // truncated file
+    for (size_t size : {size_t(0), size_t(16), data.size() / 2, data.size() - 1}) {
+        auto p = writeFile("testLibraryCacheTruncated.fpcache", std::string_view(data).substr(0, size));
+        LibraryCache cache;
+        CHECK(!cache.open(p, hash));
+        fs::remove(p);
+    }
+
+    // missing file
+    {
+        LibraryCache cache;
+        CHECK(!cache.open(fs::temp_directory_path() / "testLibraryCacheMissing.fpcache", hash));
+    }
+
+    fs::remove(source);
+    fs::remove(path);
+    return checkFailures == 0 ? 0 : 1;
+}